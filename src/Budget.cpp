@@ -0,0 +1,54 @@
+/**
+ * Budget.cpp
+*/
+
+#include "Budget.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <unistd.h>
+
+// Calls between clock and memory checks
+static const unsigned clockInterval = 32;
+static const unsigned memoryInterval = 1024;
+
+void Budget::start( double seconds, size_t megabytes ) {
+    startTime = std::chrono::steady_clock::now();
+    timeLimited = seconds > 0;
+    timeLimit = seconds;
+    memoryLimit = megabytes <= SIZE_MAX / ( 1024 * 1024 ) ? megabytes * 1024 * 1024 : SIZE_MAX;
+    baseline = memoryLimit ? residentBytes() : 0;
+    calls = 0;
+    why = None;
+}
+
+bool Budget::exhausted( bool force ) {
+
+    if ( why != None ) {
+        return true;
+    }
+    if ( !timeLimited && !memoryLimit ) {
+        return false;
+    }
+
+    unsigned call = calls++;
+    if ( timeLimited && ( force || call % clockInterval == 0 ) && elapsed() >= timeLimit ) {
+        why = Time;
+    } else if ( memoryLimit && ( force || call % memoryInterval == 0 ) && std::max( residentBytes(), baseline ) - baseline > memoryLimit ) {
+        why = Memory;
+    }
+    return why != None;
+}
+
+double Budget::elapsed() const {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+}
+
+size_t Budget::residentBytes() {
+    // Second field of statm, in pages
+    std::ifstream statm( "/proc/self/statm" );
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf( _SC_PAGESIZE );
+}
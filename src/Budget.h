@@ -0,0 +1,53 @@
+/**
+ * Budget.h
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Wall-clock and memory budget of the analysis of one file.
+//
+// Nothing is interrupted from the outside: the visitors poll exhausted() and
+// return CXChildVisit_Break once it is true, and whatever was found up to
+// then is kept and flagged as truncated. Polling is cheap, the clock is only
+// read every few calls and the resident set size every few hundred.
+class Budget {
+
+public:
+
+    enum Reason {
+        None,
+        Time,
+        Memory
+    };
+
+    // Starts the budget of a new file. seconds <= 0 and megabytes == 0 turn
+    // the respective limit off, megabytes beyond the address space saturate. Memory is counted from the resident set size
+    // at this point, so earlier files do not count against later ones.
+    void start( double seconds, size_t megabytes );
+
+    // True once the budget is used up, and from then on. force checks the
+    // limits right away instead of on the next sampled call.
+    bool exhausted( bool force = false );
+
+    Reason reason() const { return why; }
+    double elapsed() const;
+    bool limited() const { return timeLimited || memoryLimit; }
+
+    // Resident set size of this process
+    static size_t residentBytes();
+
+private:
+
+    std::chrono::steady_clock::time_point startTime;
+    // Compared as seconds, a deadline time point overflows for large budgets
+    double timeLimit = 0;
+    bool timeLimited = false;
+    size_t memoryLimit = 0;
+    size_t baseline = 0;
+
+    unsigned calls = 0;
+    Reason why = None;
+};
@@ -0,0 +1,213 @@
+/**
+ * ClangHandles.h
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <clang-c/Index.h>
+#include <clang-c/CXCompilationDatabase.h>
+
+// Move-only owners for the libclang handles, each one disposes what it holds
+// exactly once. All of them can be default constructed empty and refilled.
+
+// Owns a CXIndex
+class ClangIndex {
+
+    CXIndex index = nullptr;
+
+public:
+
+    ClangIndex() = default;
+    explicit ClangIndex( CXIndex index ) : index(index) {}
+    ClangIndex( ClangIndex &&other ) noexcept : index(std::exchange( other.index, nullptr )) {}
+    ClangIndex &operator=( ClangIndex &&other ) noexcept {
+        std::swap( index, other.index );
+        return *this;
+    }
+    ClangIndex( const ClangIndex & ) = delete;
+    ClangIndex &operator=( const ClangIndex & ) = delete;
+    ~ClangIndex() { reset(); }
+
+    // Creates a fresh index, same arguments as clang_createIndex
+    static ClangIndex create( int excludeDeclarationsFromPCH = 0, int displayDiagnostics = 0 ) {
+        return ClangIndex( clang_createIndex( excludeDeclarationsFromPCH, displayDiagnostics ) );
+    }
+
+    CXIndex get() const { return index; }
+    explicit operator bool() const { return index != nullptr; }
+
+    void reset( CXIndex other = nullptr ) {
+        if ( index ) {
+            clang_disposeIndex( index );
+        }
+        index = other;
+    }
+};
+
+// Owns a CXTranslationUnit, must be destroyed before the index it was parsed with
+class ClangTranslationUnit {
+
+    CXTranslationUnit translationUnit = nullptr;
+
+public:
+
+    ClangTranslationUnit() = default;
+    explicit ClangTranslationUnit( CXTranslationUnit translationUnit ) : translationUnit(translationUnit) {}
+    ClangTranslationUnit( ClangTranslationUnit &&other ) noexcept
+        : translationUnit(std::exchange( other.translationUnit, nullptr )) {}
+    ClangTranslationUnit &operator=( ClangTranslationUnit &&other ) noexcept {
+        std::swap( translationUnit, other.translationUnit );
+        return *this;
+    }
+    ClangTranslationUnit( const ClangTranslationUnit & ) = delete;
+    ClangTranslationUnit &operator=( const ClangTranslationUnit & ) = delete;
+    ~ClangTranslationUnit() { reset(); }
+
+    CXTranslationUnit get() const { return translationUnit; }
+    explicit operator bool() const { return translationUnit != nullptr; }
+
+    void reset( CXTranslationUnit other = nullptr ) {
+        if ( translationUnit ) {
+            clang_disposeTranslationUnit( translationUnit );
+        }
+        translationUnit = other;
+    }
+};
+
+// Owns a CXString
+class ClangString {
+
+    CXString string;
+    bool owned;
+
+public:
+
+    explicit ClangString( CXString string ) : string(string), owned(true) {}
+    ClangString( ClangString &&other ) noexcept : string(other.string), owned(std::exchange( other.owned, false )) {}
+    ClangString &operator=( ClangString &&other ) noexcept {
+        std::swap( string, other.string );
+        std::swap( owned, other.owned );
+        return *this;
+    }
+    ClangString( const ClangString & ) = delete;
+    ClangString &operator=( const ClangString & ) = delete;
+    ~ClangString() {
+        if ( owned ) {
+            clang_disposeString( string );
+        }
+    }
+
+    // Never null, libclang strings without data read as ""
+    const char *c_str() const {
+        const char *chars = owned ? clang_getCString( string ) : nullptr;
+        return chars ? chars : "";
+    }
+    std::string str() const { return c_str(); }
+};
+
+// Owns an array of CXToken from clang_getToken or clang_tokenize
+class ClangTokens {
+
+    CXTranslationUnit translationUnit = nullptr;
+    CXToken *tokens = nullptr;
+    unsigned count = 0;
+
+public:
+
+    ClangTokens() = default;
+    ClangTokens( CXTranslationUnit translationUnit, CXToken *tokens, unsigned count )
+        : translationUnit(translationUnit), tokens(tokens), count(tokens ? count : 0) {}
+    ClangTokens( ClangTokens &&other ) noexcept
+        : translationUnit(other.translationUnit), tokens(std::exchange( other.tokens, nullptr )),
+          count(std::exchange( other.count, 0 )) {}
+    ClangTokens &operator=( ClangTokens &&other ) noexcept {
+        std::swap( translationUnit, other.translationUnit );
+        std::swap( tokens, other.tokens );
+        std::swap( count, other.count );
+        return *this;
+    }
+    ClangTokens( const ClangTokens & ) = delete;
+    ClangTokens &operator=( const ClangTokens & ) = delete;
+    ~ClangTokens() {
+        if ( tokens ) {
+            clang_disposeTokens( translationUnit, tokens, count );
+        }
+    }
+
+    // Token at a location, empty if there is none
+    static ClangTokens at( CXTranslationUnit translationUnit, CXSourceLocation location ) {
+        return ClangTokens( translationUnit, clang_getToken( translationUnit, location ), 1 );
+    }
+
+    // Every token in a source range
+    static ClangTokens in( CXTranslationUnit translationUnit, CXSourceRange range ) {
+        CXToken *tokens = nullptr;
+        unsigned count = 0;
+        clang_tokenize( translationUnit, range, &tokens, &count );
+        return ClangTokens( translationUnit, tokens, count );
+    }
+
+    unsigned size() const { return count; }
+    bool empty() const { return count == 0; }
+    const CXToken &operator[]( unsigned i ) const { return tokens[ i ]; }
+
+    ClangString spelling( unsigned i ) const {
+        return ClangString( clang_getTokenSpelling( translationUnit, tokens[ i ] ) );
+    }
+};
+
+// Owns a CXCompilationDatabase
+class ClangCompilationDatabase {
+
+    CXCompilationDatabase database = nullptr;
+
+public:
+
+    ClangCompilationDatabase() = default;
+    explicit ClangCompilationDatabase( CXCompilationDatabase database ) : database(database) {}
+    ClangCompilationDatabase( ClangCompilationDatabase &&other ) noexcept
+        : database(std::exchange( other.database, nullptr )) {}
+    ClangCompilationDatabase &operator=( ClangCompilationDatabase &&other ) noexcept {
+        std::swap( database, other.database );
+        return *this;
+    }
+    ClangCompilationDatabase( const ClangCompilationDatabase & ) = delete;
+    ClangCompilationDatabase &operator=( const ClangCompilationDatabase & ) = delete;
+    ~ClangCompilationDatabase() {
+        if ( database ) {
+            clang_CompilationDatabase_dispose( database );
+        }
+    }
+
+    CXCompilationDatabase get() const { return database; }
+    explicit operator bool() const { return database != nullptr; }
+};
+
+// Owns a CXCompileCommands list
+class ClangCompileCommands {
+
+    CXCompileCommands commands = nullptr;
+
+public:
+
+    ClangCompileCommands() = default;
+    explicit ClangCompileCommands( CXCompileCommands commands ) : commands(commands) {}
+    ClangCompileCommands( ClangCompileCommands &&other ) noexcept
+        : commands(std::exchange( other.commands, nullptr )) {}
+    ClangCompileCommands &operator=( ClangCompileCommands &&other ) noexcept {
+        std::swap( commands, other.commands );
+        return *this;
+    }
+    ClangCompileCommands( const ClangCompileCommands & ) = delete;
+    ClangCompileCommands &operator=( const ClangCompileCommands & ) = delete;
+    ~ClangCompileCommands() {
+        if ( commands ) {
+            clang_CompileCommands_dispose( commands );
+        }
+    }
+
+    unsigned size() const { return commands ? clang_CompileCommands_getSize( commands ) : 0; }
+    CXCompileCommand operator[]( unsigned i ) const { return clang_CompileCommands_getCommand( commands, i ); }
+};
@@ -0,0 +1,135 @@
+/**
+ * CompilationDatabase.cpp
+*/
+
+#include "CompilationDatabase.h"
+
+#include <algorithm>
+#include <filesystem>
+
+// Options followed by a path that is relative to the command's directory
+static const char *pathOptions[] = { "-I", "-isystem", "-iquote", "-idirafter", "-include", "-imacros", "-isysroot" };
+
+// Options about the output, dropped together with their value
+static const char *outputOptions[] = { "-o", "-MF", "-MT", "-MQ" };
+
+// Options about the output without a value
+static const char *outputFlags[] = { "-c", "-S", "-E", "-M", "-MM", "-MD", "-MMD", "-MP" };
+
+static std::string absolute( const std::string &directory, const std::string &path ) {
+    std::filesystem::path p( path );
+    if ( p.is_absolute() || directory.empty() ) {
+        return path;
+    }
+    return ( std::filesystem::path( directory ) / p ).lexically_normal().string();
+}
+
+CompilationDatabase::CompilationDatabase() {
+    // Files without an entry all share the empty set, which gets id 0
+    intern( {} );
+}
+
+bool CompilationDatabase::load( const std::string &buildDir ) {
+    CXCompilationDatabase_Error error;
+    database = ClangCompilationDatabase( clang_CompilationDatabase_fromDirectory( buildDir.c_str(), &error ) );
+    if ( error != CXCompilationDatabase_NoError ) {
+        database = ClangCompilationDatabase();
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const CompilationDatabase::FlagSet> CompilationDatabase::flagsFor( const std::string &file ) {
+
+    if ( database ) {
+        std::string complete = std::filesystem::absolute( file ).lexically_normal().string();
+        ClangCompileCommands commands( clang_CompilationDatabase_getCompileCommands( database.get(), complete.c_str() ) );
+
+        // A file compiled several times (e.g. per target) is analyzed with its first command
+        if ( commands.size() > 0 ) {
+            return intern( parserArgs( commands[ 0 ] ) );
+        }
+    }
+    return intern( {} );
+}
+
+std::vector<std::string> CompilationDatabase::files() const {
+
+    std::vector<std::string> result;
+    if ( !database ) {
+        return result;
+    }
+
+    ClangCompileCommands commands( clang_CompilationDatabase_getAllCompileCommands( database.get() ) );
+    for ( unsigned i = 0; i < commands.size(); i++ ) {
+        std::string directory = ClangString( clang_CompileCommand_getDirectory( commands[ i ] ) ).str();
+        std::string file = absolute( directory, ClangString( clang_CompileCommand_getFilename( commands[ i ] ) ).str() );
+        if ( std::find( result.begin(), result.end(), file ) == result.end() ) {
+            result.push_back( file );
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<const CompilationDatabase::FlagSet> CompilationDatabase::intern( std::vector<std::string> args ) {
+
+    auto it = flagSets.find( args );
+    if ( it != flagSets.end() ) {
+        return it->second;
+    }
+
+    // Ids follow first use
+    auto flagSet = std::make_shared<const FlagSet>( FlagSet{ static_cast<unsigned>( flagSets.size() ), args } );
+    flagSets.emplace( std::move( args ), flagSet );
+    return flagSet;
+}
+
+std::vector<std::string> CompilationDatabase::parserArgs( CXCompileCommand command ) {
+
+    std::string directory = ClangString( clang_CompileCommand_getDirectory( command ) ).str();
+    std::string file = ClangString( clang_CompileCommand_getFilename( command ) ).str();
+    std::string completeFile = absolute( directory, file );
+    unsigned numArgs = clang_CompileCommand_getNumArgs( command );
+
+    std::vector<std::string> args;
+
+    // Argument 0 is the compiler itself
+    for ( unsigned i = 1; i < numArgs; i++ ) {
+        std::string arg = ClangString( clang_CompileCommand_getArg( command, i ) ).str();
+
+        if ( arg == file || absolute( directory, arg ) == completeFile ) {
+            continue;
+        }
+        if ( std::find( std::begin( outputFlags ), std::end( outputFlags ), arg ) != std::end( outputFlags ) ) {
+            continue;
+        }
+        if ( std::find( std::begin( outputOptions ), std::end( outputOptions ), arg ) != std::end( outputOptions ) ) {
+            i++;
+            continue;
+        }
+        if ( arg.rfind( "-o", 0 ) == 0 && arg.size() > 2 ) {
+            continue;
+        }
+
+        // libclang parses from our working directory, not the build's
+        bool rewritten = false;
+        for ( const char *option : pathOptions ) {
+            std::string name = option;
+            if ( arg == name && i + 1 < numArgs ) {
+                args.push_back( arg );
+                args.push_back( absolute( directory, ClangString( clang_CompileCommand_getArg( command, ++i ) ).str() ) );
+                rewritten = true;
+                break;
+            }
+            if ( arg.rfind( name, 0 ) == 0 && arg.size() > name.size() && name == "-I" ) {
+                args.push_back( name + absolute( directory, arg.substr( name.size() ) ) );
+                rewritten = true;
+                break;
+            }
+        }
+        if ( !rewritten ) {
+            args.push_back( arg );
+        }
+    }
+    return args;
+}
@@ -0,0 +1,52 @@
+/**
+ * CompilationDatabase.h
+*/
+
+#pragma once
+
+#include "ClangHandles.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads compile_commands.json and turns each entry into the arguments
+// clang_parseTranslationUnit needs for that file.
+class CompilationDatabase {
+
+public:
+
+    // Parser arguments of a file. Files compiled with identical flags share one
+    // FlagSet, so anything derived from the flags can be keyed on its id.
+    struct FlagSet {
+        unsigned id;
+        std::vector<std::string> args;
+    };
+
+    CompilationDatabase();
+
+    // Loads buildDir/compile_commands.json, returns false if it cannot be read
+    bool load( const std::string &buildDir );
+
+    // Flags for a file, the empty set (id 0) if the database has no entry for it
+    std::shared_ptr<const FlagSet> flagsFor( const std::string &file );
+
+    // Every source file in the database, absolute and in database order
+    std::vector<std::string> files() const;
+
+    // Number of distinct flag sets handed out so far, including the empty one
+    size_t flagSetCount() const { return flagSets.size(); }
+
+private:
+
+    ClangCompilationDatabase database;
+
+    // Interned flag sets
+    std::map<std::vector<std::string>, std::shared_ptr<const FlagSet>> flagSets;
+
+    // Returns the shared FlagSet equal to args
+    std::shared_ptr<const FlagSet> intern( std::vector<std::string> args );
+
+    // The compiler arguments minus everything that is about producing output
+    static std::vector<std::string> parserArgs( CXCompileCommand command );
+};
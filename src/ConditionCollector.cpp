@@ -0,0 +1,206 @@
+/**
+ * ConditionCollector.cpp
+*/
+
+#include "ConditionCollector.h"
+#include "ClangHandles.h"
+
+// Children of a statement, a for has at most four
+using Children = SmallVector<CXCursor, 4>;
+
+static unsigned offsetOf( CXSourceLocation location ) {
+    unsigned offset = 0;
+    clang_getExpansionLocation( location, nullptr, nullptr, nullptr, &offset );
+    return offset;
+}
+
+static bool contains( const ConditionCollector::Operands &operands, const std::string &name ) {
+    for ( const ConditionOperand &operand : operands ) {
+        if ( operand.name == name ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CXChildVisitResult ConditionCollector::childVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+    static_cast<Children *>( clientData )->push_back( current );
+    return CXChildVisit_Continue;
+}
+
+// Collects what a for loop's init declares or assigns
+static CXChildVisitResult counterVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+
+    ConditionCollector::Operands *counters = static_cast<ConditionCollector::Operands *>( clientData );
+
+    if ( current.kind == CXCursor_VarDecl ) {
+        counters->push_back( { ClangString( clang_getCursorSpelling( current ) ).str(), "", "", 0 } );
+    } else if ( ( parent.kind == CXCursor_BinaryOperator || parent.kind == CXCursor_CompoundAssignOperator )
+                && current.kind == CXCursor_DeclRefExpr ) {
+        // Only the left hand side of an assignment is a counter
+        bool isAssignment = parent.kind == CXCursor_CompoundAssignOperator
+                            || clang_getCursorBinaryOperatorKind( parent ) == CXBinaryOperator_Assign;
+        CXSourceRange extent = clang_getCursorExtent( parent );
+        if ( isAssignment && offsetOf( clang_getCursorLocation( current ) ) == offsetOf( clang_getRangeStart( extent ) ) ) {
+            counters->push_back( { ClangString( clang_getCursorSpelling( current ) ).str(), "", "", 0 } );
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+ConditionCollector::BranchParts ConditionCollector::partsOf( CXTranslationUnit translationUnit, CXCursor branch ) {
+
+    BranchParts parts = { clang_getNullCursor(), clang_getNullCursor() };
+    Children children;
+    clang_visitChildren( branch, childVisitor, &children );
+    if ( children.size() < 2 ) {
+        return parts;
+    }
+
+    if ( branch.kind != CXCursor_ForStmt ) {
+        parts.condition = children[ 0 ];
+        return parts;
+    }
+
+    // init, condition and increment are all optional and libclang skips the
+    // missing ones, so place the children by the semicolons of the header
+    CXCursor body = children[ children.size() - 1 ];
+    CXSourceRange header = clang_getRange( clang_getRangeStart( clang_getCursorExtent( branch ) ),
+                                           clang_getRangeStart( clang_getCursorExtent( body ) ) );
+    ClangTokens tokens = ClangTokens::in( translationUnit, header );
+
+    unsigned semicolons[ 2 ] = { 0, 0 };
+    unsigned found = 0;
+    int depth = 0;
+    for ( unsigned i = 0; i < tokens.size() && found < 2; i++ ) {
+        if ( clang_getTokenKind( tokens[ i ] ) != CXToken_Punctuation ) {
+            continue;
+        }
+        std::string spelling = tokens.spelling( i ).str();
+        if ( spelling == "(" ) {
+            depth++;
+        } else if ( spelling == ")" ) {
+            depth--;
+        } else if ( spelling == ";" && depth == 1 ) {
+            semicolons[ found++ ] = offsetOf( clang_getTokenLocation( translationUnit, tokens[ i ] ) );
+        }
+    }
+    if ( found < 2 ) {
+        return parts;
+    }
+
+    for ( size_t i = 0; i + 1 < children.size(); i++ ) {
+        unsigned offset = offsetOf( clang_getRangeStart( clang_getCursorExtent( children[ i ] ) ) );
+        if ( offset < semicolons[ 0 ] ) {
+            parts.init = children[ i ];
+        } else if ( offset < semicolons[ 1 ] ) {
+            parts.condition = children[ i ];
+        }
+    }
+    return parts;
+}
+
+std::string ConditionCollector::contextOf( CXCursor operatorCursor ) {
+    switch ( operatorCursor.kind ) {
+        case CXCursor_BinaryOperator:
+        case CXCursor_CompoundAssignOperator:
+            return ClangString( clang_getBinaryOperatorKindSpelling(
+                clang_getCursorBinaryOperatorKind( operatorCursor ) ) ).str();
+        case CXCursor_UnaryOperator:
+            return ClangString( clang_getUnaryOperatorKindSpelling(
+                clang_getCursorUnaryOperatorKind( operatorCursor ) ) ).str();
+        case CXCursor_CallExpr:
+            return ClangString( clang_getCursorSpelling( operatorCursor ) ).str() + "()";
+        case CXCursor_ArraySubscriptExpr:
+            return "[]";
+        case CXCursor_ConditionalOperator:
+            return "?:";
+        default:
+            return "";
+    }
+}
+
+void ConditionCollector::walk( CXCursor expression, WalkState &state ) {
+
+    if ( expression.kind == CXCursor_DeclRefExpr ) {
+        CXCursor referenced = clang_getCursorReferenced( expression );
+        if ( referenced.kind != CXCursor_VarDecl && referenced.kind != CXCursor_ParmDecl ) {
+            return;
+        }
+        std::string name = ClangString( clang_getCursorSpelling( expression ) ).str();
+        if ( contains( *state.operands, name ) || ( state.excluded && contains( *state.excluded, name ) ) ) {
+            return;
+        }
+        unsigned line = 0;
+        clang_getExpansionLocation( clang_getCursorLocation( expression ), nullptr, &line, nullptr, nullptr );
+        state.operands->push_back(
+            { name, ClangString( clang_getTypeSpelling( clang_getCursorType( expression ) ) ).str(), state.context, line } );
+        return;
+    }
+
+    // An expression clang could not resolve keeps none of its operands
+    if ( expression.kind == CXCursor_UnexposedExpr || clang_isInvalid( expression.kind ) ) {
+        Children children;
+        clang_visitChildren( expression, childVisitor, &children );
+        if ( children.empty() ) {
+            walkTokens( expression, state );
+            return;
+        }
+    }
+
+    std::string context = contextOf( expression );
+    if ( context.empty() ) {
+        // Casts, parentheses and the like keep the context of their parent
+        clang_visitChildren( expression, operandVisitor, &state );
+    } else {
+        WalkState inner = { state.translationUnit, state.operands, state.excluded, context };
+        clang_visitChildren( expression, operandVisitor, &inner );
+    }
+}
+
+void ConditionCollector::walkTokens( CXCursor expression, const WalkState &state ) {
+
+    ClangTokens tokens = ClangTokens::in( state.translationUnit, clang_getCursorExtent( expression ) );
+    for ( unsigned i = 0; i < tokens.size(); i++ ) {
+        if ( clang_getTokenKind( tokens[ i ] ) != CXToken_Identifier ) {
+            continue;
+        }
+        std::string name = tokens.spelling( i ).str();
+        if ( contains( *state.operands, name ) || ( state.excluded && contains( *state.excluded, name ) ) ) {
+            continue;
+        }
+        unsigned line = 0;
+        clang_getExpansionLocation( clang_getTokenLocation( state.translationUnit, tokens[ i ] ), nullptr, &line,
+                                    nullptr, nullptr );
+        state.operands->push_back( { name, "", state.context, line, true } );
+    }
+}
+
+CXChildVisitResult ConditionCollector::operandVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+    walk( current, *static_cast<WalkState *>( clientData ) );
+    return CXChildVisit_Continue;
+}
+
+ConditionCollector::Operands ConditionCollector::collect( CXTranslationUnit translationUnit, CXCursor branch ) {
+
+    Operands operands;
+    if ( clang_Cursor_isNull( branch ) || ( branch.kind != CXCursor_IfStmt && branch.kind != CXCursor_ForStmt
+                                            && branch.kind != CXCursor_WhileStmt ) ) {
+        return operands;
+    }
+
+    BranchParts parts = partsOf( translationUnit, branch );
+    if ( clang_Cursor_isNull( parts.condition ) ) {
+        return operands;
+    }
+
+    Operands counters;
+    if ( !clang_Cursor_isNull( parts.init ) ) {
+        counterVisitor( parts.init, branch, &counters );
+        clang_visitChildren( parts.init, counterVisitor, &counters );
+    }
+
+    WalkState state = { translationUnit, &operands, &counters, "" };
+    walk( parts.condition, state );
+    return operands;
+}
@@ -0,0 +1,69 @@
+/**
+ * ConditionCollector.h
+*/
+
+#pragma once
+
+#include "SmallVector.h"
+#include <string>
+#include <clang-c/Index.h>
+
+// A variable read by the condition of a branch
+struct ConditionOperand {
+    std::string name;
+    std::string type;
+    // Innermost operator the variable is an operand of: "<", "&&", "!", "[]",
+    // "strlen()" for a call argument, "" when it is the whole condition
+    std::string context;
+    // Line of the reference, without the KPC's line shift
+    unsigned line;
+    // Taken from the tokens of a condition clang could not resolve (a macro
+    // from a header the KPC's parse does not have), so it may be any
+    // identifier and has no type
+    bool fromTokens = false;
+};
+
+// Collects every variable a branch condition reads, in one walk of the
+// condition subtree.
+//
+// The branch visitors of the detector stop at their first match, so a
+// condition like a > n && b < m only ever reports a. The collector gives all
+// of them, each with the operator it is compared or combined by.
+class ConditionCollector {
+
+public:
+
+    // Typical conditions read at most a few variables
+    using Operands = SmallVector<ConditionOperand, 4>;
+
+    // Variables in the condition of an if, while or for cursor, in source
+    // order and each once. For a for loop, the variables its own init
+    // declares or assigns are the counter and are left out. Parts of the
+    // condition clang could not resolve give their identifiers instead.
+    static Operands collect( CXTranslationUnit translationUnit, CXCursor branch );
+
+private:
+
+    // The parts of a branch statement the collector cares about
+    struct BranchParts {
+        CXCursor init;
+        CXCursor condition;
+    };
+
+    // Client data for operandVisitor
+    struct WalkState {
+        CXTranslationUnit translationUnit;
+        Operands *operands;
+        // Names that are not reported (for loop counters)
+        const Operands *excluded;
+        std::string context;
+    };
+
+    static BranchParts partsOf( CXTranslationUnit translationUnit, CXCursor branch );
+    static void walk( CXCursor expression, WalkState &state );
+    static void walkTokens( CXCursor expression, const WalkState &state );
+    static std::string contextOf( CXCursor operatorCursor );
+
+    static CXChildVisitResult childVisitor( CXCursor current, CXCursor parent, CXClientData clientData );
+    static CXChildVisitResult operandVisitor( CXCursor current, CXCursor parent, CXClientData clientData );
+};
@@ -0,0 +1,29 @@
+/**
+ * CursorSite.cpp
+*/
+
+#include "CursorSite.h"
+
+CursorSite CursorSite::of( CXCursor cursor, unsigned lineShift ) {
+    CursorSite site = { cursor.kind, 0, 0 };
+    clang_getExpansionLocation( clang_getCursorLocation( cursor ), nullptr, &site.line, &site.column, nullptr );
+    site.line += lineShift;
+    return site;
+}
+
+CXCursor CursorSite::find( CXTranslationUnit translationUnit, CXFile file ) const {
+
+    if ( !translationUnit || !file ) {
+        return clang_getNullCursor();
+    }
+
+    // The innermost cursor at the statement's keyword is the statement itself
+    CXCursor cursor = clang_getCursor( translationUnit, clang_getLocation( translationUnit, file, line, column ) );
+    unsigned foundLine, foundColumn;
+    clang_getExpansionLocation( clang_getCursorLocation( cursor ), nullptr, &foundLine, &foundColumn, nullptr );
+
+    if ( cursor.kind != kind || foundLine != line || foundColumn != column ) {
+        return clang_getNullCursor();
+    }
+    return cursor;
+}
@@ -0,0 +1,23 @@
+/**
+ * CursorSite.h
+*/
+
+#pragma once
+
+#include <clang-c/Index.h>
+
+// Position of a cursor that survives a reparse of the same file, used to find
+// the matching cursor in another translation unit.
+struct CursorSite {
+    CXCursorKind kind;
+    unsigned line;
+    unsigned column;
+
+    // Site of cursor. lineShift is added to the line, the KPC's translation
+    // unit reports lines getNumIncludeDirectives() lower than the file has.
+    static CursorSite of( CXCursor cursor, unsigned lineShift = 0 );
+
+    // The cursor of the same kind at this position of file in translationUnit,
+    // the null cursor if there is none (e.g. the code is #ifdef'd out there)
+    CXCursor find( CXTranslationUnit translationUnit, CXFile file ) const;
+};
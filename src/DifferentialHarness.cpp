@@ -0,0 +1,296 @@
+/**
+ * DifferentialHarness.cpp
+*/
+
+#include "DifferentialHarness.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+DifferentialHarness::DifferentialHarness( const std::string &program,
+                                          const std::vector<std::string> &referenceArgs,
+                                          const std::vector<std::string> &candidateArgs )
+    : program(program), referenceArgs(referenceArgs), candidateArgs(candidateArgs) {}
+
+void DifferentialHarness::addPath( const std::string &path ) {
+    if ( std::filesystem::is_directory( path ) ) {
+        std::vector<std::string> found;
+        for ( const auto &entry : std::filesystem::directory_iterator( path ) ) {
+            if ( entry.is_regular_file() && entry.path().extension() == ".c" ) {
+                found.push_back( entry.path().string() );
+            }
+        }
+        std::sort( found.begin(), found.end() );
+        files.insert( files.end(), found.begin(), found.end() );
+    } else {
+        files.push_back( path );
+    }
+}
+
+void DifferentialHarness::generateCorpus( const std::string &dir, unsigned count, unsigned seed ) {
+
+    std::filesystem::create_directories( dir );
+    std::mt19937 rng( seed );
+    auto pick = [&]( unsigned n ) { return static_cast<unsigned>( rng() % n ); };
+
+    for ( unsigned f = 0; f < count; f++ ) {
+        std::ostringstream src;
+        unsigned inputs = 1 + pick( 4 );
+        bool useFile = pick( 4 ) == 0;
+
+        src << "#include <stdio.h>\n#include <stdlib.h>\n\n";
+        src << "int main() {\n";
+        for ( unsigned i = 0; i < inputs; i++ ) {
+            src << "  int in" << i << ";\n";
+        }
+        src << "  int acc = 0;\n";
+        src << "  scanf(\"";
+        for ( unsigned i = 0; i < inputs; i++ ) {
+            src << ( i ? ", " : "" ) << "%d";
+        }
+        src << "\"";
+        for ( unsigned i = 0; i < inputs; i++ ) {
+            src << ", &in" << i;
+        }
+        src << ");\n";
+        if ( useFile ) {
+            src << "  FILE *fp = fopen(\"input.txt\", \"r\");\n  char ch;\n";
+        }
+
+        // A few nested branches, each controlled by an input, the accumulator or the file
+        unsigned branches = 1 + pick( 5 );
+        unsigned depth = 0;
+        for ( unsigned b = 0; b < branches; b++ ) {
+            std::string indent( 2 * ( depth + 1 ), ' ' );
+            std::string control = "in" + std::to_string( pick( inputs ) );
+            switch ( pick( useFile ? 4 : 3 ) ) {
+                case 0:
+                    src << indent << "for (int i" << b << " = 0; i" << b << " < " << control << "; i" << b << "++) {\n"
+                        << indent << "  acc += rand() % " << 2 + pick( 9 ) << ";\n";
+                    break;
+                case 1:
+                    src << indent << "while (" << control << " > " << pick( 10 ) << ") {\n"
+                        << indent << "  " << control << "--;\n";
+                    break;
+                case 2:
+                    src << indent << "if (acc > " << pick( 100 ) << ") {\n"
+                        << indent << "  acc -= " << 1 + pick( 5 ) << ";\n";
+                    break;
+                default:
+                    src << indent << "while (1) {\n"
+                        << indent << "  ch = getc(fp);\n"
+                        << indent << "  if (ch == EOF) {\n"
+                        << indent << "    break;\n"
+                        << indent << "  }\n";
+                    break;
+            }
+            if ( pick( 2 ) ) {
+                depth++;
+            } else {
+                src << indent << "}\n";
+            }
+        }
+        while ( depth > 0 ) {
+            src << std::string( 2 * depth--, ' ' ) << "}\n";
+        }
+        src << "  printf(\"%d\\n\", acc);\n}\n";
+
+        std::string path = dir + "/gen_" + std::to_string( f ) + ".c";
+        std::ofstream( path ) << src.str();
+        files.push_back( path );
+    }
+}
+
+std::vector<DifferentialHarness::EngineRun> DifferentialHarness::runEngine( const std::vector<std::string> &args,
+                                                                            const std::vector<std::string> &group,
+                                                                            double &seconds ) const {
+
+    std::vector<EngineRun> result( group.size(), EngineRun{ {}, false } );
+    seconds = 0.0;
+
+    std::vector<std::string> command = { program };
+    command.insert( command.end(), args.begin(), args.end() );
+    command.insert( command.end(), group.begin(), group.end() );
+    std::vector<char *> argv;
+    for ( std::string &arg : command ) {
+        argv.push_back( arg.data() );
+    }
+    argv.push_back( nullptr );
+
+    // Other jobs spawn at the same time, an inherited write end would keep
+    // this run's read loop waiting for their children too
+    int pipeFds[2];
+    if ( pipe2( pipeFds, O_CLOEXEC ) != 0 ) {
+        return result;
+    }
+
+    // stdout goes to the harness, diagnostics from libclang are dropped
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_adddup2( &actions, pipeFds[1], STDOUT_FILENO );
+    posix_spawn_file_actions_addclose( &actions, pipeFds[0] );
+    posix_spawn_file_actions_addclose( &actions, pipeFds[1] );
+    posix_spawn_file_actions_addopen( &actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0 );
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid;
+    int spawned = posix_spawn( &pid, program.c_str(), &actions, nullptr, argv.data(), environ );
+    posix_spawn_file_actions_destroy( &actions );
+    close( pipeFds[1] );
+    if ( spawned != 0 ) {
+        close( pipeFds[0] );
+        return result;
+    }
+
+    std::string output;
+    char buffer[4096];
+    ssize_t n;
+    while ( ( n = read( pipeFds[0], buffer, sizeof( buffer ) ) ) > 0 ) {
+        output.append( buffer, n );
+    }
+    close( pipeFds[0] );
+
+    int status;
+    waitpid( pid, &status, 0 );
+    seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    bool ok = WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+
+    // The first file's report comes first, every further one after a line
+    // with its path (see main)
+    size_t current = 0;
+    std::istringstream lines( output );
+    std::string line;
+    while ( std::getline( lines, line ) ) {
+        if ( current + 1 < group.size() && line == group[ current + 1 ] + ":" ) {
+            current++;
+        } else if ( line.rfind( "Line ", 0 ) == 0 ) {
+            result[ current ].features.push_back( line );
+        }
+    }
+    for ( EngineRun &run : result ) {
+        std::sort( run.features.begin(), run.features.end() );
+        run.ok = ok;
+    }
+    return result;
+}
+
+std::vector<DifferentialHarness::EngineRun> DifferentialHarness::runGroup( const std::vector<std::string> &args,
+                                                                           const std::vector<std::string> &group,
+                                                                           double &seconds ) const {
+
+    std::vector<EngineRun> result = runEngine( args, group, seconds );
+    if ( group.size() < 2 || result.front().ok ) {
+        return result;
+    }
+    for ( size_t i = 0; i < group.size(); i++ ) {
+        double fileSeconds;
+        result[ i ] = runEngine( args, { group[ i ] }, fileSeconds ).front();
+        seconds += fileSeconds;
+    }
+    return result;
+}
+
+
+void DifferentialHarness::printDiff( const EngineRun &reference, const EngineRun &candidate ) {
+    std::vector<std::string> missing, extra;
+    std::set_difference( reference.features.begin(), reference.features.end(),
+                         candidate.features.begin(), candidate.features.end(), std::back_inserter( missing ) );
+    std::set_difference( candidate.features.begin(), candidate.features.end(),
+                         reference.features.begin(), reference.features.end(), std::back_inserter( extra ) );
+    for ( const std::string &line : missing ) {
+        std::cout << "    - " << line << "\n";
+    }
+    for ( const std::string &line : extra ) {
+        std::cout << "    + " << line << "\n";
+    }
+}
+
+unsigned DifferentialHarness::run( unsigned jobs ) {
+
+    // Files go round robin into one group per job, task 2*g is the reference
+    // run of group g and task 2*g+1 the candidate run
+    size_t groupCount = std::min<size_t>( std::max( jobs, 1u ), files.size() );
+    std::vector<std::vector<std::string>> groups( groupCount );
+    std::vector<std::vector<size_t>> members( groupCount );
+    for ( size_t i = 0; i < files.size(); i++ ) {
+        groups[ i % groupCount ].push_back( files[ i ] );
+        members[ i % groupCount ].push_back( i );
+    }
+
+    std::vector<std::vector<EngineRun>> runs( groupCount * 2 );
+    std::vector<double> seconds( groupCount * 2, 0.0 );
+    std::atomic<size_t> next( 0 );
+    auto worker = [&]() {
+        for ( size_t task = next++; task < runs.size(); task = next++ ) {
+            runs[ task ] = runGroup( task % 2 ? candidateArgs : referenceArgs, groups[ task / 2 ], seconds[ task ] );
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for ( unsigned i = 0; i < std::max( jobs, 1u ); i++ ) {
+        workers.emplace_back( worker );
+    }
+    for ( std::thread &thread : workers ) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    // Back into file order
+    std::vector<const EngineRun *> references( files.size() ), candidates( files.size() );
+    double referenceTotal = 0.0, candidateTotal = 0.0;
+    for ( size_t g = 0; g < groupCount; g++ ) {
+        for ( size_t m = 0; m < members[ g ].size(); m++ ) {
+            references[ members[ g ][ m ] ] = &runs[ 2 * g ][ m ];
+            candidates[ members[ g ][ m ] ] = &runs[ 2 * g + 1 ][ m ];
+        }
+        referenceTotal += seconds[ 2 * g ];
+        candidateTotal += seconds[ 2 * g + 1 ];
+    }
+
+    unsigned mismatches = 0;
+    std::cout << std::fixed << std::setprecision( 3 );
+    for ( size_t i = 0; i < files.size(); i++ ) {
+        const EngineRun &reference = *references[ i ];
+        const EngineRun &candidate = *candidates[ i ];
+
+        const char *verdict = "OK  ";
+        if ( !reference.ok || !candidate.ok ) {
+            verdict = "FAIL";
+        } else if ( reference.features != candidate.features ) {
+            verdict = "DIFF";
+        }
+        if ( verdict[0] != 'O' ) {
+            mismatches++;
+        }
+
+        std::cout << verdict << " " << files[ i ] << "\n";
+        if ( verdict[0] == 'D' ) {
+            printDiff( reference, candidate );
+        } else if ( verdict[0] == 'F' ) {
+            std::cout << "    " << ( reference.ok ? "candidate" : "reference" ) << " exited abnormally\n";
+        }
+    }
+
+    std::cout << "\n" << files.size() - mismatches << "/" << files.size() << " files match, "
+              << "reference " << referenceTotal << "s, candidate " << candidateTotal << "s, "
+              << "speed ratio " << ( candidateTotal > 0 ? referenceTotal / candidateTotal : 0.0 ) << "x "
+              << "(" << elapsed << "s wall, " << groupCount << " groups, " << std::max( jobs, 1u ) << " jobs)\n";
+
+    return mismatches;
+}
@@ -0,0 +1,67 @@
+/**
+ * DifferentialHarness.h
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Runs the detector twice over the files, once with the reference options and
+// once with a candidate set of (performance) options, and diffs the feature
+// sets per file.
+//
+// The files are split into one group per job, and each engine analyzes a
+// group in one process, the way a batch run does, so options that carry
+// state from file to file are exercised. The engines are separate processes
+// and cannot share libclang state. A group whose process fails is run again
+// file by file, so a crash is reported for the file it happened on instead
+// of taking the harness or the rest of the group down.
+class DifferentialHarness {
+
+public:
+
+    // Result of one engine on one file
+    struct EngineRun {
+        // "Line N: ..." lines printed by the detector, sorted
+        std::vector<std::string> features;
+        // Process exited normally with status 0
+        bool ok;
+    };
+
+    // program is the detector binary, the args are added in front of the file name
+    DifferentialHarness( const std::string &program,
+                         const std::vector<std::string> &referenceArgs,
+                         const std::vector<std::string> &candidateArgs );
+
+    // Adds a C file, or every .c file in a directory
+    void addPath( const std::string &path );
+
+    // Writes count generated C programs into dir and adds them
+    void generateCorpus( const std::string &dir, unsigned count, unsigned seed = 512 );
+
+    // Runs both engines over every file with up to jobs processes at a time,
+    // prints the report and returns the number of files whose results differ
+    unsigned run( unsigned jobs );
+
+private:
+
+    std::string program;
+    std::vector<std::string> referenceArgs;
+    std::vector<std::string> candidateArgs;
+
+    // Files to analyze, in the order they were added
+    std::vector<std::string> files;
+
+    // Spawns one detector process on a group of files and splits its output
+    // by file. seconds is the wall-clock time of the process.
+    std::vector<EngineRun> runEngine( const std::vector<std::string> &args, const std::vector<std::string> &group,
+                                      double &seconds ) const;
+
+    // Runs a group, and its files one by one if the group's process failed
+    std::vector<EngineRun> runGroup( const std::vector<std::string> &args, const std::vector<std::string> &group,
+                                     double &seconds ) const;
+
+    // Prints the features only one of the two runs found
+    static void printDiff( const EngineRun &reference, const EngineRun &candidate );
+};
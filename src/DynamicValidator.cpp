@@ -0,0 +1,239 @@
+/**
+ * DynamicValidator.cpp
+*/
+
+#include "DynamicValidator.h"
+#include "OutputName.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+DynamicValidator::DynamicValidator( const std::string &fileName, const std::vector<std::string> &compileArgs,
+                                    const std::string &outDir )
+    : filename(fileName), compileArgs(compileArgs), outDir(outDir) {
+    std::string name = outputName( fileName );
+    sourceFile = outDir + "/" + name + ".probed.c";
+    binary = outDir + "/" + name + ".probed";
+    logFile = outDir + "/" + name + ".log";
+}
+
+bool DynamicValidator::build( const ProbePlan &plan ) {
+
+    probes = plan.probes;
+    runs.clear();
+
+    std::error_code error;
+    std::filesystem::create_directories( outDir, error );
+    std::ofstream out( sourceFile, std::ios::trunc );
+    out << plan.source;
+    out.close();
+    if ( !out ) {
+        return false;
+    }
+    std::filesystem::remove( logFile, error );
+
+    // The probed file lives elsewhere, quoted includes still have to resolve
+    // next to the original
+    const char *cc = std::getenv( "CC" );
+    std::vector<std::string> command = { cc && *cc ? cc : "clang", "-w", "-O1" };
+    std::string dir = std::filesystem::path( filename ).parent_path().string();
+    command.push_back( "-iquote" );
+    command.push_back( dir.empty() ? "." : dir );
+    command.insert( command.end(), compileArgs.begin(), compileArgs.end() );
+    command.push_back( sourceFile );
+    command.push_back( "-o" );
+    command.push_back( binary );
+    return execute( command, "", {}, 0, false );
+}
+
+void DynamicValidator::run( const std::vector<std::string> &inputs, const std::vector<std::string> &args,
+                            double timeout ) {
+
+    runs.clear();
+    for ( size_t k = 0; k < inputs.size(); k++ ) {
+        Run result;
+        result.input = inputs[ k ];
+
+        std::vector<std::string> command = { binary };
+        bool inputAsFile = false;
+        for ( const std::string &arg : args ) {
+            std::string expanded = arg;
+            for ( size_t at = expanded.find( "@@" ); at != std::string::npos; at = expanded.find( "@@", at ) ) {
+                expanded.replace( at, 2, inputs[ k ] );
+                at += inputs[ k ].size();
+                inputAsFile = true;
+            }
+            command.push_back( expanded );
+        }
+
+        std::string countFile = binary + ".probe." + std::to_string( k );
+        std::error_code error;
+        std::filesystem::remove( countFile, error );
+        result.completed = execute( command, inputAsFile ? "" : inputs[ k ], { "SIF_PROBE_OUT=" + countFile },
+                                    timeout, true );
+        result.counts = readCounts( countFile );
+        std::filesystem::remove( countFile, error );
+        runs.push_back( result );
+    }
+}
+
+bool DynamicValidator::execute( const std::vector<std::string> &argv, const std::string &input,
+                                const std::vector<std::string> &environment, double timeout, bool quiet ) const {
+
+    std::vector<std::string> command = argv;
+    std::vector<char *> args;
+    for ( std::string &arg : command ) {
+        args.push_back( arg.data() );
+    }
+    args.push_back( nullptr );
+
+    std::vector<std::string> variables = environment;
+    std::vector<char *> env;
+    for ( std::string &variable : variables ) {
+        env.push_back( variable.data() );
+    }
+    for ( char **variable = environ; *variable; variable++ ) {
+        env.push_back( *variable );
+    }
+    env.push_back( nullptr );
+
+    // Programs under test write whatever they like, the compiler's complaints are kept
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_addopen( &actions, STDIN_FILENO, input.empty() ? "/dev/null" : input.c_str(),
+                                      O_RDONLY, 0 );
+    if ( quiet ) {
+        posix_spawn_file_actions_addopen( &actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0 );
+        posix_spawn_file_actions_addopen( &actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0 );
+    } else {
+        posix_spawn_file_actions_addopen( &actions, STDOUT_FILENO, logFile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644 );
+        posix_spawn_file_actions_adddup2( &actions, STDOUT_FILENO, STDERR_FILENO );
+    }
+
+    pid_t pid;
+    int spawned = posix_spawnp( &pid, command[ 0 ].c_str(), &actions, nullptr, args.data(), env.data() );
+    posix_spawn_file_actions_destroy( &actions );
+    if ( spawned != 0 ) {
+        std::ofstream( logFile, std::ios::app ) << command[ 0 ] << ": cannot be started\n";
+        return false;
+    }
+
+    int status;
+    if ( timeout <= 0 ) {
+        waitpid( pid, &status, 0 );
+        return WIFEXITED( status ) && ( quiet || WEXITSTATUS( status ) == 0 );
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    while ( waitpid( pid, &status, WNOHANG ) == 0 ) {
+        if ( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() > timeout ) {
+            kill( pid, SIGKILL );
+            waitpid( pid, &status, 0 );
+            return false;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+    return WIFEXITED( status ) && ( quiet || WEXITSTATUS( status ) == 0 );
+}
+
+std::vector<DynamicValidator::ProbeCounts> DynamicValidator::readCounts( const std::string &countFile ) const {
+
+    std::vector<ProbeCounts> counts;
+    std::ifstream in( countFile );
+    if ( !in ) {
+        return counts;
+    }
+    counts.resize( probes.size() );
+    unsigned id;
+    ProbeCounts probe;
+    while ( in >> id >> probe.notTaken >> probe.taken ) {
+        if ( id < counts.size() ) {
+            counts[ id ] = probe;
+        }
+    }
+    return counts;
+}
+
+void DynamicValidator::report( const std::vector<std::string> &features, std::ostream &out ) const {
+
+    // Only runs that wrote their counts are evidence
+    std::vector<const Run *> counted;
+    for ( const Run &run : runs ) {
+        if ( !run.counts.empty() ) {
+            counted.push_back( &run );
+        }
+    }
+
+    out << "Validation of " << filename << ": " << counted.size() << " of " << runs.size()
+        << " runs counted, " << probes.size() << " probes\n";
+
+    for ( const std::string &feature : features ) {
+        std::vector<std::string> details;
+        bool reached = false;
+        bool sensitive = false;
+        bool probed = false;
+        // A declaration only tells whether the feature was reached when it has no branch probe
+        bool branchProbed = false;
+        bool declarationReached = false;
+
+        for ( size_t id = 0; id < probes.size(); id++ ) {
+            const Probe &probe = probes[ id ];
+            if ( std::find( probe.features.begin(), probe.features.end(), feature ) == probe.features.end() ) {
+                continue;
+            }
+            probed = true;
+
+            if ( probe.kind == Probe::Declaration ) {
+                unsigned hits = 0;
+                for ( const Run *run : counted ) {
+                    hits += run->counts[ id ].taken > 0;
+                }
+                declarationReached |= hits > 0;
+                details.push_back( "declaration reached in " + std::to_string( hits ) + "/"
+                                   + std::to_string( counted.size() ) + " runs" );
+                continue;
+            }
+
+            // Range of both outcome counts over the runs, any spread means the input steers it
+            ProbeCounts low = { ~0ULL, ~0ULL }, high;
+            bool branchReached = false;
+            for ( const Run *run : counted ) {
+                const ProbeCounts &counts = run->counts[ id ];
+                low.notTaken = std::min( low.notTaken, counts.notTaken );
+                low.taken = std::min( low.taken, counts.taken );
+                high.notTaken = std::max( high.notTaken, counts.notTaken );
+                high.taken = std::max( high.taken, counts.taken );
+                branchReached |= counts.notTaken + counts.taken > 0;
+            }
+            if ( counted.empty() ) {
+                low = high;
+            }
+            branchProbed = true;
+            reached |= branchReached;
+            sensitive |= low.notTaken != high.notTaken || low.taken != high.taken;
+            details.push_back( "line " + std::to_string( probe.line ) + ": taken " + std::to_string( low.taken ) + "-"
+                               + std::to_string( high.taken ) + ", not taken " + std::to_string( low.notTaken )
+                               + "-" + std::to_string( high.notTaken ) );
+        }
+
+        if ( !branchProbed ) {
+            reached = declarationReached;
+        }
+        out << "  " << feature << ": "
+            << ( !probed ? "not probed" : sensitive ? "sensitive" : reached ? "insensitive" : "not reached" ) << "\n";
+        for ( const std::string &detail : details ) {
+            out << "    " << detail << "\n";
+        }
+    }
+}
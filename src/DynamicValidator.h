@@ -0,0 +1,79 @@
+/**
+ * DynamicValidator.h
+*/
+
+#pragma once
+
+#include "ProbeInstrumenter.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Checks the static result against real executions: compiles the probed
+// source of a file (ProbeInstrumenter), runs it on sample inputs and reports
+// per feature whether the outcomes of its branches change with the input.
+//
+// A feature is sensitive when one of its branches went a different way, or a
+// different number of times, for two of the inputs. Branches that were reached
+// but behaved the same on every input make it insensitive, which either means
+// the samples do not vary it or the static analysis over-reported.
+class DynamicValidator {
+
+public:
+
+    // Counts of one probe in one run
+    struct ProbeCounts {
+        unsigned long long notTaken = 0;
+        unsigned long long taken = 0;
+    };
+
+    // One execution of the probed program
+    struct Run {
+        std::string input;
+        // Exited without a signal and before the timeout, the exit code is not checked
+        bool completed = false;
+        // Indexed by probe id, empty if the program wrote no counts
+        std::vector<ProbeCounts> counts;
+    };
+
+    // compileArgs are the ones of the analysis (-I, -D, ...), the probed files
+    // and binaries go to outDir
+    DynamicValidator( const std::string &fileName, const std::vector<std::string> &compileArgs,
+                      const std::string &outDir = "out/validate" );
+
+    // Writes the probed source and compiles it with $CC, clang by default.
+    // False if it does not compile, the compiler output is in the log.
+    bool build( const ProbePlan &plan );
+
+    // Runs the program once per input. The input is the program's stdin, or
+    // its path replaces @@ in args. Runs are killed after timeout seconds.
+    void run( const std::vector<std::string> &inputs, const std::vector<std::string> &args, double timeout );
+
+    // Prints the verdict per feature, features in the order given
+    void report( const std::vector<std::string> &features, std::ostream &out ) const;
+
+    const std::string &getLog() const { return logFile; }
+    const std::vector<Run> &getRuns() const { return runs; }
+
+private:
+
+    std::string filename;
+    std::vector<std::string> compileArgs;
+    std::string outDir;
+
+    // Output files, named by outputName() of the analyzed file
+    std::string sourceFile;
+    std::string binary;
+    std::string logFile;
+
+    std::vector<Probe> probes;
+    std::vector<Run> runs;
+
+    // Spawns argv with stdin from input ("" for /dev/null) and extra
+    // environment, returns false if it could not start, crashed or timed out
+    bool execute( const std::vector<std::string> &argv, const std::string &input,
+                  const std::vector<std::string> &environment, double timeout, bool quiet ) const;
+
+    // Reads a count file of the probe runtime
+    std::vector<ProbeCounts> readCounts( const std::string &countFile ) const;
+};
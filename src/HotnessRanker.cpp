@@ -0,0 +1,75 @@
+/**
+ * HotnessRanker.cpp
+*/
+
+#include "HotnessRanker.h"
+
+#include <algorithm>
+#include <cmath>
+
+static bool isLoop( CXCursorKind kind ) {
+    return kind == CXCursor_ForStmt || kind == CXCursor_WhileStmt || kind == CXCursor_DoStmt;
+}
+
+void HotnessRanker::prepare( const std::vector<CXCursor> &branches ) {
+
+    struct Extent {
+        unsigned begin;
+        unsigned end;
+        size_t index;
+    };
+
+    metrics.assign( branches.size(), { 0, 0, false } );
+    scores.clear();
+    current = 0;
+
+    std::vector<Extent> extents;
+    extents.reserve( branches.size() );
+    for ( size_t i = 0; i < branches.size(); i++ ) {
+        if ( clang_Cursor_isNull( branches[ i ] ) ) {
+            continue;
+        }
+        CXSourceRange range = clang_getCursorExtent( branches[ i ] );
+        Extent extent = { 0, 0, i };
+        clang_getExpansionLocation( clang_getRangeStart( range ), nullptr, nullptr, nullptr, &extent.begin );
+        clang_getExpansionLocation( clang_getRangeEnd( range ), nullptr, nullptr, nullptr, &extent.end );
+        metrics[ i ].size = extent.end > extent.begin ? extent.end - extent.begin : 0;
+        metrics[ i ].isLoop = isLoop( branches[ i ].kind );
+        extents.push_back( extent );
+    }
+
+    // Sweep in source order with a stack of the loops still open
+    std::sort( extents.begin(), extents.end(), []( const Extent &a, const Extent &b ) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    } );
+    std::vector<unsigned> openLoops;
+    for ( const Extent &extent : extents ) {
+        while ( !openLoops.empty() && openLoops.back() <= extent.begin ) {
+            openLoops.pop_back();
+        }
+        metrics[ extent.index ].depth = openLoops.size();
+        if ( metrics[ extent.index ].isLoop ) {
+            openLoops.push_back( extent.end );
+        }
+    }
+}
+
+void HotnessRanker::attribute( const std::string &name ) {
+
+    if ( current >= metrics.size() ) {
+        return;
+    }
+    const BranchMetrics &branch = metrics[ current ];
+
+    Score &score = scores[ name ];
+    score.influence += std::pow( loopIterations, branch.depth ) * branch.size * ( branch.isLoop ? loopIterations : 1.0 );
+    score.branches++;
+    score.loopBounds += branch.isLoop;
+    score.maxDepth = std::max( score.maxDepth, branch.depth + branch.isLoop );
+    score.codeSize += branch.size;
+}
+
+const HotnessRanker::Score *HotnessRanker::scoreOf( const std::string &name ) const {
+    auto it = scores.find( name );
+    return it == scores.end() ? nullptr : &it->second;
+}
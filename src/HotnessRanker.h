@@ -0,0 +1,74 @@
+/**
+ * HotnessRanker.h
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <clang-c/Index.h>
+
+// Static estimate of how much execution each seminal input feature controls,
+// so a fuzzing budget can go to the inputs that drive the expensive paths.
+//
+// Every branch point is measured once before the traversal: how many loops
+// enclose it and how much code it spans. During the traversal, each feature a
+// branch reports is credited with
+//
+//     loopIterations ^ (enclosing loops) * (bytes of the branch)
+//
+// times loopIterations again if the branch is a loop, since a variable in a
+// loop condition bounds how often the body runs (n in TF_1_rand.c). Features
+// that steer many, deeply nested or large branches come out on top.
+class HotnessRanker {
+
+public:
+
+    // Iterations assumed for a loop whose trip count is not known statically
+    static constexpr double loopIterations = 8.0;
+
+    // What a feature was credited with
+    struct Score {
+        double influence = 0.0;
+        // Branches that reported the feature
+        unsigned branches = 0;
+        // Loops whose condition it appears in
+        unsigned loopBounds = 0;
+        // Deepest loop nesting of those branches
+        unsigned maxDepth = 0;
+        // Bytes of code of those branches
+        unsigned codeSize = 0;
+    };
+
+    // Measures the branch cursors the traversal is about to visit, drops the
+    // scores of the previous file
+    void prepare( const std::vector<CXCursor> &branches );
+
+    // The traversal is now inside branches[index]
+    void enterBranch( size_t index ) { current = index; }
+
+    // The current branch reported a feature
+    void attribute( const std::string &name );
+
+    // Score of a feature, nullptr if no branch reported it
+    const Score *scoreOf( const std::string &name ) const;
+
+    double influenceOf( const std::string &name ) const {
+        const Score *score = scoreOf( name );
+        return score ? score->influence : 0.0;
+    }
+
+private:
+
+    struct BranchMetrics {
+        // Loops around the branch, not counting the branch itself
+        unsigned depth;
+        unsigned size;
+        bool isLoop;
+    };
+
+    std::vector<BranchMetrics> metrics;
+    size_t current = 0;
+    std::unordered_map<std::string, Score> scores;
+};
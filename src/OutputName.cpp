@@ -0,0 +1,26 @@
+/**
+ * OutputName.cpp
+*/
+
+#include "OutputName.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+std::string outputName( const std::string &file ) {
+
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute( file, error );
+    std::string key = error ? file : path.lexically_normal().string();
+
+    // 32 bit FNV-1a, short enough to read, collisions need thousands of namesakes
+    uint32_t hash = 0x811c9dc5u;
+    for ( char c : key ) {
+        hash ^= static_cast<unsigned char>( c );
+        hash *= 0x01000193u;
+    }
+    char suffix[ 10 ];
+    std::snprintf( suffix, sizeof( suffix ), "-%08x", hash );
+    return std::filesystem::path( file ).stem().string() + suffix;
+}
@@ -0,0 +1,13 @@
+/**
+ * OutputName.h
+*/
+
+#pragma once
+
+#include <string>
+
+// Base name of the files written for an analyzed file: its stem and a hash of
+// its absolute path, main-1c3f09a2 for x/main.c. Files with the same name in
+// different directories get different outputs in one run, and the same file
+// always gets the same one.
+std::string outputName( const std::string &file );
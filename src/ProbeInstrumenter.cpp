@@ -0,0 +1,260 @@
+/**
+ * ProbeInstrumenter.cpp
+*/
+
+#include "ProbeInstrumenter.h"
+#include "ClangHandles.h"
+#include "SmallVector.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+// Runtime of the probes, put in front of the program. Every probe hit is one
+// store into the ring, the ring is folded into the counters when it is full
+// and the counters are written to $SIF_PROBE_OUT at exit. One ring per
+// process, the probes are not meant for multi-threaded programs.
+static const char *prelude =
+    "/* Probes added by SeminalInputFeatureDetector --validate */\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#define __SIF_RING 4096\n"
+    "static unsigned __sif_ring[__SIF_RING];\n"
+    "static unsigned __sif_used;\n"
+    "static unsigned long long __sif_counts[__SIF_PROBES][2];\n"
+    "static void __sif_drain(void) {\n"
+    "    unsigned i;\n"
+    "    for (i = 0; i < __sif_used; i++) __sif_counts[__sif_ring[i] >> 1][__sif_ring[i] & 1]++;\n"
+    "    __sif_used = 0;\n"
+    "}\n"
+    "static void __sif_flush(void) {\n"
+    "    const char *path = getenv(\"SIF_PROBE_OUT\");\n"
+    "    FILE *out;\n"
+    "    unsigned i;\n"
+    "    __sif_drain();\n"
+    "    if (!path || !(out = fopen(path, \"w\"))) return;\n"
+    "    for (i = 0; i < __SIF_PROBES; i++) fprintf(out, \"%u %llu %llu\\n\", i, __sif_counts[i][0], __sif_counts[i][1]);\n"
+    "    fclose(out);\n"
+    "}\n"
+    "__attribute__((constructor)) static void __sif_start(void) { atexit(__sif_flush); }\n"
+    "static int __sif_record(unsigned id, int taken) {\n"
+    "    if (__sif_used == __SIF_RING) __sif_drain();\n"
+    "    __sif_ring[__sif_used++] = id << 1 | (unsigned)taken;\n"
+    "    return taken;\n"
+    "}\n"
+    "#define __sif_probe(id, c) __sif_record((id), (c) ? 1 : 0)\n"
+    "#define __sif_hit(id) ((void)__sif_record((id), 1))\n";
+
+// Children of a branch statement
+using Children = SmallVector<CXCursor, 4>;
+
+static CXChildVisitResult childVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+    static_cast<Children *>( clientData )->push_back( current );
+    return CXChildVisit_Continue;
+}
+
+ProbeInstrumenter::ProbeInstrumenter( const std::string &fileName, CXTranslationUnit translationUnit,
+                                      unsigned lineShift )
+    : filename(fileName), translationUnit(translationUnit), lineShift(lineShift) {}
+
+bool ProbeInstrumenter::loadSource() {
+
+    std::ifstream in( filename, std::ios::binary );
+    if ( !in ) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    source = contents.str();
+
+    lineStarts = { 0 };
+    for ( size_t i = 0; i < source.size(); i++ ) {
+        if ( source[ i ] == '\n' ) {
+            lineStarts.push_back( i + 1 );
+        }
+    }
+    return true;
+}
+
+size_t ProbeInstrumenter::offsetOf( CXSourceLocation location ) const {
+
+    if ( !clang_Location_isFromMainFile( location ) ) {
+        return std::string::npos;
+    }
+    unsigned line, column;
+    clang_getExpansionLocation( location, nullptr, &line, &column, nullptr );
+    line += lineShift;
+    if ( line == 0 || line > lineStarts.size() || column == 0 ) {
+        return std::string::npos;
+    }
+    size_t offset = lineStarts[ line - 1 ] + column - 1;
+    return offset <= source.size() ? offset : std::string::npos;
+}
+
+bool ProbeInstrumenter::textAt( size_t offset, const std::string &token ) const {
+    return offset != std::string::npos && source.compare( offset, token.size(), token ) == 0;
+}
+
+bool ProbeInstrumenter::addBranch( CXCursor branch, const std::vector<std::string> &features ) {
+
+    if ( translationUnit == nullptr || clang_Cursor_isNull( branch )
+         || ( branch.kind != CXCursor_IfStmt && branch.kind != CXCursor_ForStmt && branch.kind != CXCursor_WhileStmt ) ) {
+        return false;
+    }
+
+    // The header runs up to the statement the condition guards
+    Children children;
+    clang_visitChildren( branch, childVisitor, &children );
+    if ( children.size() < 2 ) {
+        return false;
+    }
+    CXCursor guarded = branch.kind == CXCursor_ForStmt ? children[ children.size() - 1 ] : children[ 1 ];
+    CXSourceRange header = clang_getRange( clang_getRangeStart( clang_getCursorExtent( branch ) ),
+                                           clang_getRangeStart( clang_getCursorExtent( guarded ) ) );
+    ClangTokens tokens = ClangTokens::in( translationUnit, header );
+    if ( tokens.size() < 3 ) {
+        return false;
+    }
+    auto offsetOfToken = [&]( unsigned i ) { return offsetOf( clang_getTokenLocation( translationUnit, tokens[ i ] ) ); };
+
+    // The keyword and the parenthesis must be where the translation unit says,
+    // otherwise the branch comes out of a macro
+    std::string keyword = tokens.spelling( 0 ).str();
+    if ( !textAt( offsetOfToken( 0 ), keyword ) || tokens.spelling( 1 ).str() != "("
+         || !textAt( offsetOfToken( 1 ), "(" ) ) {
+        return false;
+    }
+
+    // Delimiters of the condition: the parentheses, or the semicolons of a for
+    size_t open = std::string::npos, close = std::string::npos;
+    int depth = 0;
+    for ( unsigned i = 1; i < tokens.size(); i++ ) {
+        std::string spelling = tokens.spelling( i ).str();
+        if ( spelling == "(" ) {
+            depth++;
+        } else if ( spelling == ")" ) {
+            depth--;
+        }
+        bool delimiter = branch.kind == CXCursor_ForStmt ? spelling == ";" && depth == 1
+                                                         : ( i == 1 || ( spelling == ")" && depth == 0 ) );
+        if ( !delimiter ) {
+            continue;
+        }
+        size_t offset = offsetOfToken( i );
+        if ( !textAt( offset, spelling ) ) {
+            return false;
+        }
+        if ( open == std::string::npos ) {
+            open = offset;
+        } else {
+            close = offset;
+            break;
+        }
+    }
+
+    // for ( init; ; inc ) has no condition to probe
+    if ( open == std::string::npos || close == std::string::npos
+         || source.find_first_not_of( " \t\r\n", open + 1 ) >= close ) {
+        return false;
+    }
+
+    unsigned id = probes.size();
+    unsigned line = 0;
+    clang_getExpansionLocation( clang_getCursorLocation( branch ), nullptr, &line, nullptr, nullptr );
+    probes.push_back( { Probe::Branch, line + lineShift, features } );
+    insertions.push_back( { open + 1, "__sif_probe(" + std::to_string( id ) + ", (" } );
+    insertions.push_back( { close, "))" } );
+    return true;
+}
+
+// Client data for declarationVisitor
+struct DeclarationSearch {
+    unsigned lineShift;
+    // Wanted declarations, name and line
+    std::set<std::pair<std::string, unsigned>> wanted;
+    // Declaration statements that are the init of a for, nothing can follow them
+    std::set<unsigned> forInits;
+    // Found: name, line and the extent of the declaration statement
+    std::vector<std::pair<std::pair<std::string, unsigned>, CXSourceRange>> found;
+};
+
+CXChildVisitResult ProbeInstrumenter::declarationVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+
+    DeclarationSearch *search = static_cast<DeclarationSearch *>( clientData );
+
+    if ( !clang_Location_isFromMainFile( clang_getCursorLocation( current ) ) ) {
+        return CXChildVisit_Continue;
+    }
+
+    if ( current.kind == CXCursor_DeclStmt && parent.kind == CXCursor_ForStmt ) {
+        unsigned offset;
+        clang_getExpansionLocation( clang_getCursorLocation( current ), nullptr, nullptr, nullptr, &offset );
+        search->forInits.insert( offset );
+    } else if ( current.kind == CXCursor_VarDecl && parent.kind == CXCursor_DeclStmt ) {
+        unsigned line, offset;
+        clang_getExpansionLocation( clang_getCursorLocation( current ), nullptr, &line, nullptr, nullptr );
+        clang_getExpansionLocation( clang_getCursorLocation( parent ), nullptr, nullptr, nullptr, &offset );
+        std::pair<std::string, unsigned> key( ClangString( clang_getCursorSpelling( current ) ).str(),
+                                              line + search->lineShift );
+        if ( search->wanted.count( key ) && !search->forInits.count( offset ) ) {
+            search->found.emplace_back( key, clang_getCursorExtent( parent ) );
+            search->wanted.erase( key );
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+unsigned ProbeInstrumenter::addDeclarations( const std::vector<std::pair<std::string, unsigned>> &declarations ) {
+
+    if ( translationUnit == nullptr || declarations.empty() ) {
+        return 0;
+    }
+
+    DeclarationSearch search = { lineShift, { declarations.begin(), declarations.end() }, {}, {} };
+    clang_visitChildren( clang_getTranslationUnitCursor( translationUnit ), declarationVisitor, &search );
+
+    unsigned added = 0;
+    for ( const auto &[key, extent] : search.found ) {
+        // The extent ends behind the semicolon of the declaration statement
+        size_t end = offsetOf( clang_getRangeEnd( extent ) );
+        if ( end == std::string::npos || end == 0 || !textAt( end - 1, ";" ) ) {
+            continue;
+        }
+        unsigned id = probes.size();
+        probes.push_back( { Probe::Declaration, key.second, { key.first } } );
+        insertions.push_back( { end, " __sif_hit(" + std::to_string( id ) + ");" } );
+        added++;
+    }
+    return added;
+}
+
+ProbePlan ProbeInstrumenter::plan() const {
+
+    ProbePlan result;
+    result.probes = probes;
+    result.source = "#define __SIF_PROBES " + std::to_string( std::max<size_t>( probes.size(), 1 ) ) + "\n";
+    result.source += prelude;
+    // Diagnostics and __LINE__ keep referring to the original file, its name
+    // is a string literal there
+    std::string quoted;
+    for ( char c : filename ) {
+        if ( c == '"' || c == '\\' ) {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    result.source += "#line 1 \"" + quoted + "\"\n";
+
+    std::vector<Insertion> sorted = insertions;
+    std::stable_sort( sorted.begin(), sorted.end(),
+                      []( const Insertion &a, const Insertion &b ) { return a.offset < b.offset; } );
+    size_t copied = 0;
+    for ( const Insertion &insertion : sorted ) {
+        result.source.append( source, copied, insertion.offset - copied );
+        result.source += insertion.text;
+        copied = insertion.offset;
+    }
+    result.source.append( source, copied, std::string::npos );
+    return result;
+}
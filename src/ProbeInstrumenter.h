@@ -0,0 +1,90 @@
+/**
+ * ProbeInstrumenter.h
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <clang-c/Index.h>
+
+// A counter the instrumented program keeps
+struct Probe {
+    enum Kind {
+        // Counts how often a branch condition was false and true
+        Branch,
+        // Counts how often a feature's declaration was executed
+        Declaration
+    } kind;
+    // Line in the original file
+    unsigned line;
+    // Features the probe is evidence for
+    std::vector<std::string> features;
+};
+
+// Instrumented source and its probes, probe i has id i
+struct ProbePlan {
+    std::string source;
+    std::vector<Probe> probes;
+};
+
+// Rewrites a C file with a probe around every detected branch condition and
+// after the declaration of every reported local variable.
+//
+// Probes are placed by token positions of the analyzed translation unit and
+// only where the original text has the expected token, so a branch that
+// comes out of a macro or a line that moved is left alone rather than broken.
+// The probes write into a ring buffer that is only folded into the counters
+// when it is full and written out once at exit (see the prelude in the .cpp),
+// which keeps the instrumented program close to native speed.
+class ProbeInstrumenter {
+
+public:
+
+    // translationUnit is the one the cursors belong to, lineShift what has to
+    // be added to its lines to get the lines of fileName
+    ProbeInstrumenter( const std::string &fileName, CXTranslationUnit translationUnit, unsigned lineShift );
+
+    // Reads the original file, false if it cannot be read
+    bool loadSource();
+
+    // Probes the condition of an if, for or while cursor, false if it cannot be placed
+    bool addBranch( CXCursor branch, const std::vector<std::string> &features );
+
+    // Probes the declarations of local variables, given by name and line in
+    // the original file, in one walk of the translation unit. Globals and
+    // declarations it cannot place are skipped, returns how many were probed.
+    unsigned addDeclarations( const std::vector<std::pair<std::string, unsigned>> &declarations );
+
+    // The rewritten file. Probe output goes to the file named by $SIF_PROBE_OUT.
+    ProbePlan plan() const;
+
+private:
+
+    // Text inserted in front of the original character at offset
+    struct Insertion {
+        size_t offset;
+        std::string text;
+    };
+
+    std::string filename;
+    CXTranslationUnit translationUnit;
+    unsigned lineShift;
+
+    std::string source;
+    // Offset of every line start in source
+    std::vector<size_t> lineStarts;
+
+    std::vector<Insertion> insertions;
+    std::vector<Probe> probes;
+
+    // Offset in source of a location of the translation unit, npos if it is
+    // not in the main file or outside the source
+    size_t offsetOf( CXSourceLocation location ) const;
+
+    // The source text at offset starts with token
+    bool textAt( size_t offset, const std::string &token ) const;
+
+    static CXChildVisitResult declarationVisitor( CXCursor current, CXCursor parent, CXClientData clientData );
+};
@@ -0,0 +1,167 @@
+/**
+ * ResultFile.cpp
+*/
+
+#include "ResultFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ResultFile;
+
+// Appends a record with the given payload and strings, padded to 8 bytes
+template <typename Payload>
+static void appendRecord( std::string &buffer, RecordKind kind, uint16_t flags, const Payload &payload,
+                          const std::string &first, const std::string &second = "" ) {
+    size_t size = sizeof( RecordHeader ) + sizeof( Payload ) + first.size() + second.size();
+    size = ( size + 7 ) & ~static_cast<size_t>( 7 );
+
+    RecordHeader header = { static_cast<uint32_t>( size ), kind, flags };
+    size_t start = buffer.size();
+    buffer.append( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    buffer.append( reinterpret_cast<const char *>( &payload ), sizeof( payload ) );
+    buffer.append( first );
+    buffer.append( second );
+    buffer.resize( start + size, '\0' );
+}
+
+ResultWriter::~ResultWriter() {
+    if ( fd >= 0 ) {
+        close( fd );
+    }
+}
+
+bool ResultWriter::open( const std::string &path ) {
+
+    fd = ::open( path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644 );
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 ) {
+        return false;
+    }
+    if ( info.st_size == 0 ) {
+        char header[8];
+        std::memcpy( header, magic, sizeof( magic ) );
+        std::memcpy( header + 4, &version, sizeof( version ) );
+        return write( fd, header, sizeof( header ) ) == sizeof( header );
+    }
+    return true;
+}
+
+bool ResultWriter::append( const std::string &file, uint16_t flags,
+                           const std::vector<SeminalInputFeatureDetector::SeminalInputFeature> &features ) {
+
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    std::string buffer;
+    FilePayload filePayload = { static_cast<uint32_t>( file.size() ), static_cast<uint32_t>( features.size() ) };
+    appendRecord( buffer, FileRecord, flags, filePayload, file );
+    for ( const SeminalInputFeatureDetector::SeminalInputFeature &feature : features ) {
+        // Lengths are 16 bit, longer spellings are cut
+        std::string name = feature.name.substr( 0, UINT16_MAX );
+        std::string type = feature.type.substr( 0, UINT16_MAX );
+        FeaturePayload payload = { static_cast<uint32_t>( feature.line ), static_cast<uint16_t>( name.size() ),
+                                   static_cast<uint16_t>( type.size() ) };
+        appendRecord( buffer, FeatureRecord, 0, payload, name, type );
+    }
+
+    // A write may be cut short, the rest follows until it fails. A group that
+    // stays torn is cut off by the shard runner.
+    for ( size_t written = 0; written < buffer.size(); ) {
+        ssize_t count = write( fd, buffer.data() + written, buffer.size() - written );
+        if ( count < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( count <= 0 ) {
+            return false;
+        }
+        written += count;
+    }
+    return true;
+}
+
+ResultReader::ResultReader( ResultReader &&other ) noexcept
+    : data(std::exchange( other.data, nullptr )), length(std::exchange( other.length, 0 )) {}
+
+ResultReader::~ResultReader() {
+    if ( data ) {
+        munmap( const_cast<char *>( data ), length );
+    }
+}
+
+bool ResultReader::open( const std::string &path ) {
+
+    int fd = ::open( path.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || info.st_size < 8 ) {
+        close( fd );
+        return false;
+    }
+
+    void *mapping = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( mapping == MAP_FAILED ) {
+        return false;
+    }
+    data = static_cast<const char *>( mapping );
+    length = info.st_size;
+
+    uint32_t fileVersion;
+    std::memcpy( &fileVersion, data + 4, sizeof( fileVersion ) );
+    return std::memcmp( data, magic, sizeof( magic ) ) == 0 && fileVersion == version;
+}
+
+size_t ResultReader::groupEnd( size_t offset ) const {
+
+    if ( offset + sizeof( RecordHeader ) + sizeof( FilePayload ) > length ) {
+        return 0;
+    }
+    const RecordHeader *header = reinterpret_cast<const RecordHeader *>( data + offset );
+    if ( header->kind != FileRecord || header->size > length - offset
+         || header->size < sizeof( RecordHeader ) + sizeof( FilePayload ) ) {
+        return 0;
+    }
+    const FilePayload *file = reinterpret_cast<const FilePayload *>( header + 1 );
+    if ( file->pathLength > header->size - sizeof( RecordHeader ) - sizeof( FilePayload ) ) {
+        return 0;
+    }
+
+    size_t end = offset + header->size;
+    for ( uint32_t i = 0; i < file->featureCount; i++ ) {
+        if ( end + sizeof( RecordHeader ) + sizeof( FeaturePayload ) > length ) {
+            return 0;
+        }
+        const RecordHeader *feature = reinterpret_cast<const RecordHeader *>( data + end );
+        const FeaturePayload *payload = reinterpret_cast<const FeaturePayload *>( feature + 1 );
+        if ( feature->kind != FeatureRecord || feature->size > length - end
+             || feature->size < sizeof( RecordHeader ) + sizeof( FeaturePayload ) + payload->nameLength
+                                + payload->typeLength ) {
+            return 0;
+        }
+        end += feature->size;
+    }
+    return end;
+}
+
+size_t ResultReader::completeLength() const {
+
+    size_t offset = 8;
+    size_t end;
+    while ( ( end = groupEnd( offset ) ) != 0 ) {
+        offset = end;
+    }
+    return offset;
+}
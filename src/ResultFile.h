@@ -0,0 +1,165 @@
+/**
+ * ResultFile.h
+*/
+
+#pragma once
+
+#include "SeminalInputFeatureDetector.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary result files of sharded runs.
+//
+// A file is an 8 byte header followed by records. Every record starts with a
+// RecordHeader and is padded to a multiple of 8 bytes, integers are in the
+// byte order of the machine that wrote them, strings are not terminated. The
+// version in the header doubles as a byte order mark, a file from a machine
+// of the other order is not a result file. A File record is followed by the
+// Feature records of that file. Writers only ever append, one group per
+// analyzed file, so a crash can at worst leave a torn last group. The reader
+// detects it through the File record's feature count and stops there, the
+// shard runner cuts it off before a new process appends behind it. Readers
+// map the file and hand out views into the mapping, nothing is parsed or copied.
+namespace ResultFile {
+
+    constexpr char magic[4] = { 'S', 'I', 'F', 'R' };
+    constexpr uint32_t version = 1;
+
+    enum RecordKind : uint16_t {
+        FileRecord = 1,
+        FeatureRecord = 2
+    };
+
+    // Flags of a File record
+    enum FileFlags : uint16_t {
+        ParseFailed = 1,
+        HasErrors = 2,
+        // The analyzer process died on this file, it has no features
+        Crashed = 4,
+        // The file ran out of its budget, its features are partial
+        Truncated = 8,
+        // The analyzer process made no progress on this file and was killed
+        TimedOut = 16,
+        // The file was not parsed on its own, HasErrors says nothing
+        Uncounted = 32
+    };
+
+    struct RecordHeader {
+        // Whole record including this header and the padding
+        uint32_t size;
+        uint16_t kind;
+        uint16_t flags;
+    };
+
+    // Payload of a File record, followed by the path
+    struct FilePayload {
+        uint32_t pathLength;
+        uint32_t featureCount;
+    };
+
+    // Payload of a Feature record, followed by the name and the type
+    struct FeaturePayload {
+        uint32_t line;
+        uint16_t nameLength;
+        uint16_t typeLength;
+    };
+
+    // A feature as the reader sees it, the views point into the mapping
+    struct FeatureView {
+        std::string_view file;
+        uint32_t line;
+        std::string_view name;
+        std::string_view type;
+    };
+
+    // An analyzed file as the reader sees it
+    struct FileView {
+        std::string_view path;
+        uint16_t flags;
+    };
+}
+
+// Appends the results of analyzed files to a result file
+class ResultWriter {
+
+public:
+
+    ResultWriter() = default;
+    ResultWriter( const ResultWriter & ) = delete;
+    ResultWriter &operator=( const ResultWriter & ) = delete;
+    ~ResultWriter();
+
+    // Opens path for appending and writes the header if it is new, false on failure
+    bool open( const std::string &path );
+
+    // Appends one file and its features as one group, false if it could not
+    // be written completely
+    bool append( const std::string &file, uint16_t flags,
+                 const std::vector<SeminalInputFeatureDetector::SeminalInputFeature> &features );
+
+private:
+
+    int fd = -1;
+};
+
+// Read-only mapping of a result file
+class ResultReader {
+
+public:
+
+    ResultReader() = default;
+    ResultReader( const ResultReader & ) = delete;
+    ResultReader &operator=( const ResultReader & ) = delete;
+    ResultReader( ResultReader &&other ) noexcept;
+    ~ResultReader();
+
+    // Maps path, false if it cannot be read or is not a result file
+    bool open( const std::string &path );
+
+    // Walks the complete file groups in order. Returns false if the file ends
+    // in a torn group, which is skipped.
+    template <typename FileCallback, typename FeatureCallback>
+    bool forEach( FileCallback onFile, FeatureCallback onFeature ) const;
+
+    // Length of the file up to the end of its last complete group
+    size_t completeLength() const;
+
+private:
+
+    const char *data = nullptr;
+    size_t length = 0;
+
+    // End of the group starting at offset, 0 if the group is torn
+    size_t groupEnd( size_t offset ) const;
+};
+
+template <typename FileCallback, typename FeatureCallback>
+bool ResultReader::forEach( FileCallback onFile, FeatureCallback onFeature ) const {
+
+    using namespace ResultFile;
+
+    size_t offset = 8;
+    size_t end;
+    while ( ( end = groupEnd( offset ) ) != 0 ) {
+        const RecordHeader *header = reinterpret_cast<const RecordHeader *>( data + offset );
+        const FilePayload *file = reinterpret_cast<const FilePayload *>( header + 1 );
+        FileView fileView = { std::string_view( reinterpret_cast<const char *>( file + 1 ), file->pathLength ),
+                              header->flags };
+
+        onFile( fileView );
+        size_t position = offset + header->size;
+        for ( uint32_t i = 0; i < file->featureCount; i++ ) {
+            const RecordHeader *record = reinterpret_cast<const RecordHeader *>( data + position );
+            const FeaturePayload *feature = reinterpret_cast<const FeaturePayload *>( record + 1 );
+            const char *strings = reinterpret_cast<const char *>( feature + 1 );
+            onFeature( FeatureView{ fileView.path, feature->line,
+                                    std::string_view( strings, feature->nameLength ),
+                                    std::string_view( strings + feature->nameLength, feature->typeLength ) } );
+            position += record->size;
+        }
+        offset = end;
+    }
+    return offset == length;
+}
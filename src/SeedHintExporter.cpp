@@ -0,0 +1,393 @@
+/**
+ * SeedHintExporter.cpp
+*/
+
+#include "SeedHintExporter.h"
+#include "ClangHandles.h"
+#include "OutputName.h"
+
+#include <clang-c/Index.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+// Library calls that bring input into the program. Argument indices are -1
+// when the call has no such argument.
+struct InputFunction {
+    const char *name;
+    int formatArg;
+    int streamArg;
+    int firstDestArg;
+};
+
+static const InputFunction inputFunctions[] = {
+    { "scanf",   0, -1,  1 },
+    { "fscanf",  1,  0,  2 },
+    { "sscanf",  1,  0,  2 },
+    { "getc",   -1,  0, -1 },
+    { "fgetc",  -1,  0, -1 },
+    { "getchar",-1, -1, -1 },
+    { "fgets",  -1,  2,  0 },
+    { "fread",  -1,  3,  0 },
+    { "getline",-1,  2,  0 },
+    { "fopen",  -1, -1, -1 },
+};
+
+// Client data for targetVisitor
+struct TargetContext {
+    SeedHintExporter *exporter;
+    std::string target;
+};
+
+static std::string cursorSpelling( CXCursor cursor ) {
+    return ClangString( clang_getCursorSpelling( cursor ) ).str();
+}
+
+// Client data for firstOfKind
+struct KindSearch {
+    CXCursorKind kind;
+    CXCursor found;
+};
+
+static CXChildVisitResult firstOfKind( CXCursor current, CXCursor parent, CXClientData clientData ) {
+    KindSearch *search = static_cast<KindSearch *>( clientData );
+    if ( current.kind == search->kind ) {
+        search->found = current;
+        return CXChildVisit_Break;
+    }
+    return CXChildVisit_Recurse;
+}
+
+// Spelling of the first cursor of the given kind at or below cursor, "" if none
+static std::string firstSpelling( CXCursor cursor, CXCursorKind kind ) {
+    if ( cursor.kind == kind ) {
+        return cursorSpelling( cursor );
+    }
+    KindSearch search = { kind, clang_getNullCursor() };
+    clang_visitChildren( cursor, firstOfKind, &search );
+    return clang_Cursor_isNull( search.found ) ? "" : cursorSpelling( search.found );
+}
+
+// Turns a C string literal as spelled in the source into its value
+static std::string unquote( const std::string &literal ) {
+    std::string value;
+    size_t begin = literal.find( '"' );
+    size_t end = literal.rfind( '"' );
+    if ( begin == std::string::npos || end <= begin ) {
+        return value;
+    }
+    for ( size_t i = begin + 1; i < end; i++ ) {
+        if ( literal[ i ] == '\\' && i + 1 < end ) {
+            switch ( literal[ ++i ] ) {
+                case 'n': value += '\n'; break;
+                case 't': value += '\t'; break;
+                case 'r': value += '\r'; break;
+                case '0': value += '\0'; break;
+                default: value += literal[ i ]; break;
+            }
+        } else {
+            value += literal[ i ];
+        }
+    }
+    return value;
+}
+
+SeedHintExporter::SeedHintExporter( CXTranslationUnit translationUnit, const std::string &fileName,
+                                    unsigned lineShift )
+    : translationUnit(translationUnit), filename(fileName), lineShift(lineShift) {}
+
+void SeedHintExporter::collectInputSources() {
+    inputSources.clear();
+    formatTokens.clear();
+    clang_visitChildren( clang_getTranslationUnitCursor( translationUnit ), sourceVisitor, this );
+}
+
+CXChildVisitResult SeedHintExporter::sourceVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+
+    // instance of SeedHintExporter
+    SeedHintExporter *instance = static_cast<SeedHintExporter *>(clientData);
+
+    // Headers cannot read the program's input, skip them entirely
+    if ( !clang_Location_isFromMainFile( clang_getCursorLocation( current ) ) ) {
+        return CXChildVisit_Continue;
+    }
+
+    switch ( current.kind ) {
+        case CXCursor_VarDecl: {
+            TargetContext context = { instance, cursorSpelling( current ) };
+            clang_visitChildren( current, targetVisitor, &context );
+            return CXChildVisit_Continue;
+        }
+        case CXCursor_BinaryOperator:
+            if ( clang_getCursorBinaryOperatorKind( current ) != CXBinaryOperator_Assign ) {
+                break;
+            }
+            [[fallthrough]];
+        case CXCursor_CompoundAssignOperator: {
+            // The left hand side is visited first, its first reference is the target
+            TargetContext context = { instance, "" };
+            clang_visitChildren( current, targetVisitor, &context );
+            return CXChildVisit_Continue;
+        }
+        case CXCursor_CallExpr:
+            instance->recordCall( current, "" );
+            break;
+        default:
+            break;
+    }
+    return CXChildVisit_Recurse;
+}
+
+CXChildVisitResult SeedHintExporter::targetVisitor( CXCursor current, CXCursor parent, CXClientData clientData ) {
+
+    TargetContext *context = static_cast<TargetContext *>(clientData);
+
+    if ( current.kind == CXCursor_DeclRefExpr && context->target.empty() ) {
+        context->target = cursorSpelling( current );
+    } else if ( current.kind == CXCursor_CallExpr ) {
+        context->exporter->recordCall( current, context->target );
+    }
+    return CXChildVisit_Recurse;
+}
+
+void SeedHintExporter::recordCall( CXCursor call, const std::string &target ) {
+
+    std::string name = cursorSpelling( call );
+    const InputFunction *function = nullptr;
+    for ( const InputFunction &candidate : inputFunctions ) {
+        if ( name == candidate.name ) {
+            function = &candidate;
+            break;
+        }
+    }
+    if ( !function ) {
+        return;
+    }
+
+    int numArgs = clang_Cursor_getNumArguments( call );
+
+    InputSource source;
+    source.function = name;
+    source.position = 0;
+    clang_getExpansionLocation( clang_getCursorLocation( call ), nullptr, &source.line, nullptr, nullptr );
+    source.line += lineShift;
+
+    if ( name == "fopen" ) {
+        // The "stream" of a FILE * is the file it was opened from
+        source.variable = target;
+        source.stream = numArgs > 0 ? unquote( firstSpelling( clang_Cursor_getArgument( call, 0 ), CXCursor_StringLiteral ) ) : "";
+        if ( !source.variable.empty() ) {
+            inputSources.push_back( source );
+        }
+        return;
+    }
+
+    source.stream = "stdin";
+    if ( function->streamArg >= 0 && function->streamArg < numArgs ) {
+        std::string stream = firstSpelling( clang_Cursor_getArgument( call, function->streamArg ), CXCursor_DeclRefExpr );
+        if ( !stream.empty() ) {
+            source.stream = stream;
+        }
+    }
+
+    if ( function->formatArg >= 0 && function->formatArg < numArgs ) {
+        // scanf family, every destination argument consumes one conversion
+        source.format = unquote( firstSpelling( clang_Cursor_getArgument( call, function->formatArg ), CXCursor_StringLiteral ) );
+        std::vector<std::string> conversions = parseFormat( source.format, formatTokens );
+        for ( int i = function->firstDestArg; i < numArgs; i++ ) {
+            InputSource dest = source;
+            dest.variable = firstSpelling( clang_Cursor_getArgument( call, i ), CXCursor_DeclRefExpr );
+            dest.position = i - function->firstDestArg + 1;
+            if ( dest.position <= conversions.size() ) {
+                dest.conversion = conversions[ dest.position - 1 ];
+            }
+            if ( !dest.variable.empty() ) {
+                inputSources.push_back( dest );
+            }
+        }
+    } else {
+        // Buffer readers fill their first argument, the rest return the value read
+        if ( function->firstDestArg >= 0 && function->firstDestArg < numArgs ) {
+            source.variable = firstSpelling( clang_Cursor_getArgument( call, function->firstDestArg ), CXCursor_DeclRefExpr );
+        } else {
+            source.variable = target;
+        }
+        if ( !source.variable.empty() ) {
+            inputSources.push_back( source );
+        }
+    }
+}
+
+std::vector<std::string> SeedHintExporter::parseFormat( const std::string &format, std::vector<std::string> &literals ) {
+
+    std::vector<std::string> conversions;
+    std::string literal;
+
+    for ( size_t i = 0; i < format.size(); i++ ) {
+        if ( format[ i ] != '%' ) {
+            literal += format[ i ];
+            continue;
+        }
+        if ( i + 1 < format.size() && format[ i + 1 ] == '%' ) {
+            literal += format[ ++i ];
+            continue;
+        }
+
+        // Only literals the parser has to match are useful tokens, whitespace matches anything
+        if ( literal.find_first_not_of( " \t\n" ) != std::string::npos ) {
+            literals.push_back( literal );
+        }
+        literal.clear();
+
+        size_t start = i++;
+        bool suppressed = i < format.size() && format[ i ] == '*';
+        while ( i < format.size() && !std::strchr( "diouxXaAeEfFgGcspn[", format[ i ] ) ) {
+            i++;
+        }
+        if ( i < format.size() && format[ i ] == '[' ) {
+            i = format.find( ']', i + 2 );
+            if ( i == std::string::npos ) {
+                i = format.size() - 1;
+            }
+        }
+        if ( !suppressed ) {
+            conversions.push_back( format.substr( start, i - start + 1 ) );
+        }
+    }
+
+    if ( literal.find_first_not_of( " \t\n" ) != std::string::npos ) {
+        literals.push_back( literal );
+    }
+    return conversions;
+}
+
+std::vector<const SeedHintExporter::InputSource *>
+SeedHintExporter::sourcesFor( const SeminalInputFeatureDetector::SeminalInputFeature &feature ) const {
+
+    std::vector<const InputSource *> sources;
+    bool isFile = feature.type == "FILE *";
+    for ( const InputSource &source : inputSources ) {
+        if ( source.variable == feature.name || ( isFile && source.stream == feature.name ) ) {
+            sources.push_back( &source );
+        }
+    }
+    return sources;
+}
+
+std::string SeedHintExporter::escapeToken( const std::string &token ) {
+    static const char hex[] = "0123456789abcdef";
+    std::string escaped;
+    for ( unsigned char c : token ) {
+        if ( c == '"' || c == '\\' ) {
+            escaped += '\\';
+            escaped += c;
+        } else if ( c < 0x20 || c >= 0x7f ) {
+            escaped += "\\x";
+            escaped += hex[ c >> 4 ];
+            escaped += hex[ c & 0xf ];
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Boundary values worth trying for a scanf conversion
+static std::vector<std::string> interestingValues( const std::string &conversion ) {
+    if ( conversion.empty() ) {
+        return {};
+    }
+    char spec = conversion.back();
+    bool isLong = conversion.find( 'l' ) != std::string::npos || conversion.find( 'j' ) != std::string::npos;
+    bool isShort = conversion.find( 'h' ) != std::string::npos;
+
+    if ( std::strchr( "di", spec ) ) {
+        if ( isLong ) {
+            return { "0", "1", "-1", "9223372036854775807", "-9223372036854775808" };
+        }
+        if ( isShort ) {
+            return { "0", "1", "-1", "32767", "-32768" };
+        }
+        return { "0", "1", "-1", "2147483647", "-2147483648" };
+    }
+    if ( std::strchr( "uoxX", spec ) ) {
+        return { "0", "1", isLong ? "18446744073709551615" : isShort ? "65535" : "4294967295" };
+    }
+    if ( std::strchr( "aAeEfFgG", spec ) ) {
+        return { "0.0", "-1.0", "1e308", "nan", "inf" };
+    }
+    return {};
+}
+
+void SeedHintExporter::exportHints( const std::vector<SeminalInputFeatureDetector::SeminalInputFeature> &features,
+                                    const std::string &outDir ) {
+
+    std::filesystem::create_directories( outDir );
+    std::string name = outputName( filename );
+    std::string dictPath = outDir + "/" + name + ".dict";
+    std::string seedsPath = outDir + "/" + name + ".seeds";
+
+    std::ofstream dict( dictPath );
+    std::ofstream seeds( seedsPath );
+    if ( !dict || !seeds ) {
+        std::cerr << "Could not write seed hints to " << outDir << "\n";
+        return;
+    }
+
+    dict << "# Fuzzing dictionary for " << filename << " (AFL/libFuzzer -dict format)\n";
+    seeds << "# Seminal input features of " << filename << ", highest priority first\n"
+          << "# rank\tline\tfeature\tkind\tsource\n";
+
+    std::set<std::string> written;
+    unsigned tokenCount = 0;
+    auto addToken = [&]( const std::string &prefix, const std::string &value ) {
+        if ( written.insert( value ).second ) {
+            dict << prefix << "_" << tokenCount++ << "=\"" << escapeToken( value ) << "\"\n";
+        }
+    };
+
+    // Format separators are needed for any input to get past the parser at all
+    for ( const std::string &token : formatTokens ) {
+        addToken( "format", token );
+    }
+
+    for ( size_t i = 0; i < features.size(); i++ ) {
+        const SeminalInputFeatureDetector::SeminalInputFeature &feature = features[ i ];
+        std::vector<const InputSource *> sources = sourcesFor( feature );
+
+        std::string description;
+        for ( const InputSource *source : sources ) {
+            if ( !description.empty() ) {
+                description += "; ";
+            }
+            if ( source->function == "fopen" ) {
+                description += "file \"" + source->stream + "\" via fopen (line " + std::to_string( source->line ) + ")";
+            } else {
+                description += source->stream + " via " + source->function;
+                for ( const InputSource &opened : inputSources ) {
+                    if ( opened.function == "fopen" && opened.variable == source->stream ) {
+                        description += " from file \"" + opened.stream + "\"";
+                        break;
+                    }
+                }
+                if ( source->position ) {
+                    description += " \"" + escapeToken( source->format ) + "\" conversion "
+                                 + std::to_string( source->position ) + " (" + source->conversion + ")";
+                }
+                description += " (line " + std::to_string( source->line ) + ")";
+            }
+
+            for ( const std::string &value : interestingValues( source->conversion ) ) {
+                addToken( feature.name, value );
+            }
+        }
+        if ( description.empty() ) {
+            description = "derived";
+        }
+
+        seeds << i + 1 << "\t" << feature.line << "\t" << feature.name << "\t"
+              << ( feature.type == "FILE *" ? "file-size" : "value" ) << "\t" << description << "\n";
+    }
+}
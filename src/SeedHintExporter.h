@@ -0,0 +1,80 @@
+/**
+ * SeedHintExporter.h
+*/
+
+#pragma once
+
+#include "SeminalInputFeatureDetector.h"
+#include <string>
+#include <vector>
+#include <clang-c/Index.h>
+
+class SeedHintExporter {
+
+public:
+
+    // Where a value read by the program comes from
+    struct InputSource {
+        // Input function that produced the value (scanf, getc, fopen, ...)
+        std::string function;
+        // Variable that receives the value
+        std::string variable;
+        // Stream the value is read from, "stdin" when implicit
+        std::string stream;
+        // Format string literal for the scanf family
+        std::string format;
+        // Conversion specifier consumed by the variable, e.g. "%d"
+        std::string conversion;
+        // 1-based position of the conversion in the format, 0 if none
+        unsigned position;
+        // Line of the call
+        unsigned line;
+    };
+
+    // lineShift is what has to be added to the lines of translationUnit to get
+    // the lines of fileName
+    SeedHintExporter( CXTranslationUnit translationUnit, const std::string &fileName, unsigned lineShift = 0 );
+
+    // Walks the already parsed translation unit once and records every input call
+    void collectInputSources();
+
+    // Writes <outDir>/<name>.dict (AFL/libFuzzer dictionary) and <outDir>/<name>.seeds
+    // (features in priority order with the input they map back to), name as
+    // given by outputName()
+    void exportHints( const std::vector<SeminalInputFeatureDetector::SeminalInputFeature> &features,
+                      const std::string &outDir );
+
+    const std::vector<InputSource> &getInputSources() const { return inputSources; }
+
+private:
+
+    // Translation unit owned by the detector, must outlive this object
+    CXTranslationUnit translationUnit;
+
+    // Name of file we are analyzing
+    std::string filename;
+    unsigned lineShift;
+
+    // Every input call found in the main file, in source order
+    std::vector<InputSource> inputSources;
+
+    // Literal pieces of scanf formats (separators the parser expects verbatim)
+    std::vector<std::string> formatTokens;
+
+    // Visitors, the first for the whole TU and the second for a single
+    // declaration or assignment whose target is already known
+    static CXChildVisitResult sourceVisitor( CXCursor current, CXCursor parent, CXClientData clientData );
+    static CXChildVisitResult targetVisitor( CXCursor current, CXCursor parent, CXClientData clientData );
+
+    // Records the input call at cursor, "target" is the variable its return value is stored in
+    void recordCall( CXCursor call, const std::string &target );
+
+    // Splits a scanf format into its conversions and literal pieces
+    static std::vector<std::string> parseFormat( const std::string &format, std::vector<std::string> &literals );
+
+    // Input sources that feed the given feature
+    std::vector<const InputSource *> sourcesFor( const SeminalInputFeatureDetector::SeminalInputFeature &feature ) const;
+
+    // Escapes a value for the AFL dictionary syntax
+    static std::string escapeToken( const std::string &token );
+};
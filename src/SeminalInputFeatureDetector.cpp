@@ -1,360 +1,594 @@
-/** 
- * SeminalInputFeatureDetector.cpp
- * @author Carter Fultz (cmfultz)
-*/
-
-#include "SeminalInputFeatureDetector.h"
-
-#include <clang-c/Index.h>
-#include <iostream>
-#include <fstream>
-#include <iterator>
-
-SeminalInputFeatureDetector::SeminalInputFeatureDetector( const std::string &filename, bool debug )
-    : filename(std::move(filename)), debug(debug) {
-
-    // Get a pointer to the KPC, the cursors obtained from this are need their
-    // translation unit to still be active in memory to be able to obtain
-    // valid memory reads and prevent heap corruption.
-    kpc = new KeyPointsCollector( std::string(filename), false );
-    
-    // Obtained from part 1, KeyPointsCollector.cpp
-    kpc->collectCursors();
-    cursorObjs = kpc->getCursorObjs();
-    varDecls = kpc->getVarDecls();
-    count = 0;
-
-    translationUnit =
-        clang_parseTranslationUnit( index, filename.c_str(), nullptr, 0,
-                                   nullptr, 0, CXTranslationUnit_None );
-    cxFile = clang_getFile( translationUnit, filename.c_str() );
-}
-
-
-
-CXChildVisitResult SeminalInputFeatureDetector::ifStmtBranch(CXCursor current,
-                                                      CXCursor parent,
-                                                      CXClientData clientData) {
-
-    // instance of SeminalInputFeatureDetector
-    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
-
-    if ( !clang_Cursor_isNull( current ) ) {
-
-        // Cursor Type
-        CXType cursor_type = clang_getCursorType( current );
-        CXString type_spelling = clang_getTypeSpelling( cursor_type );
-
-        // Cursor Location
-        CXSourceLocation location = clang_getCursorLocation( current );
-        unsigned line;
-        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
-        line += instance->kpc->getNumIncludeDirectives();
-        
-        // Cursor Token
-        CXToken *cursor_token = clang_getToken( instance->kpc->getTU(), location );
-        if ( cursor_token ) {
-            CXString token_spelling = clang_getTokenSpelling( instance->translationUnit, *cursor_token );
-
-            if ( parent.kind == CXCursor_IfStmt && ( current.kind == CXCursor_UnexposedExpr 
-                                                || current.kind == CXCursor_BinaryOperator ) ) {
-                if ( instance->debug ) {
-                    CXString parent_kind_spelling = clang_getCursorKindSpelling( parent.kind );
-                    CXString current_kind_spelling = clang_getCursorKindSpelling( current.kind );
-
-                    std::cout << "  Kind: " << clang_getCString(parent_kind_spelling) << "\n"
-                              << "    Kind: " << clang_getCString(current_kind_spelling) << "\n"
-                              << "      Type: " << clang_getCString(type_spelling) << "\n"
-                              << "      Token: " << clang_getCString(token_spelling) << "\n"
-                              << "      Line " << line << "\n\n";
-
-                    clang_disposeString( parent_kind_spelling );
-                    clang_disposeString( current_kind_spelling );
-                }
-
-                instance->getDeclLocation( clang_getCString(token_spelling), instance->count++, clang_getCString(type_spelling) );
-                clang_disposeString( type_spelling );
-                clang_disposeString( token_spelling );
-                clang_disposeTokens( instance->translationUnit, cursor_token, 1 );
-                return CXChildVisit_Break;
-            }
-
-            clang_disposeString( token_spelling );
-            clang_disposeTokens( instance->translationUnit, cursor_token, 1 );
-        }
-
-        clang_disposeString( type_spelling );
-    }
-    return CXChildVisit_Recurse;
-}
-
-CXChildVisitResult SeminalInputFeatureDetector::forStmtBranch(CXCursor current,
-                                                      CXCursor parent,
-                                                      CXClientData clientData) {
-
-    // instance of SeminalInputFeatureDetector
-    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
-
-    if ( !clang_Cursor_isNull( current ) ) {
-        
-        // Cursor Type
-        CXType cursor_type = clang_getCursorType( current );
-        CXString type_spelling = clang_getTypeSpelling( cursor_type );
-
-        // Cursor Location
-        CXSourceLocation location = clang_getCursorLocation( current );
-        unsigned line;
-        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
-        line += instance->kpc->getNumIncludeDirectives();
-
-        // Cursor Token
-        CXToken *cursor_token = clang_getToken( instance->kpc->getTU(), location );
-        if ( cursor_token ) {
-            CXString token_spelling = clang_getTokenSpelling( instance->translationUnit, *cursor_token );
-
-            if ( (parent.kind == CXCursor_DeclStmt && current.kind == CXCursor_VarDecl) || (current.kind == CXCursor_DeclRefExpr) ) {
-                if ( instance->debug ) {
-                    CXString parent_kind_spelling = clang_getCursorKindSpelling( parent.kind );
-                    CXString current_kind_spelling = clang_getCursorKindSpelling( current.kind );
-
-                    std::cout << "  Kind: " << clang_getCString(parent_kind_spelling) << "\n"
-                              << "    Kind: " << clang_getCString(current_kind_spelling) << "\n"
-                              << "      Type: " << clang_getCString(type_spelling) << "\n"
-                              << "      Token: " << clang_getCString(token_spelling) << "\n"
-                              << "      Line " << line << "\n\n";
-
-                    clang_disposeString( parent_kind_spelling );
-                    clang_disposeString( current_kind_spelling );
-                }
-
-                instance->temp.name = clang_getCString(token_spelling);
-            }
-            
-            if ( ( parent.kind == CXCursor_BinaryOperator || parent.kind == CXCursor_CallExpr ) && current.kind == CXCursor_UnexposedExpr ) {
-                if ( instance->debug ) {
-                    CXString parent_kind_spelling = clang_getCursorKindSpelling( parent.kind );
-                    CXString current_kind_spelling = clang_getCursorKindSpelling( current.kind );
-
-                    std::cout << "  Kind: " << clang_getCString(parent_kind_spelling) << "\n"
-                              << "    Kind: " << clang_getCString(current_kind_spelling) << "\n"
-                              << "      Type: " << clang_getCString(type_spelling) << "\n"
-                              << "      Token: " << clang_getCString(token_spelling) << "\n"
-                              << "      Line " << line << "\n\n";
-                    
-                    clang_disposeString( parent_kind_spelling );
-                    clang_disposeString( current_kind_spelling );
-                }
-
-                if ( instance->temp.name != clang_getCString(token_spelling) ) {
-                    instance->getDeclLocation( clang_getCString(token_spelling), instance->count++, clang_getCString(type_spelling) );
-                    clang_disposeString( type_spelling );
-                    clang_disposeString( token_spelling );
-                    clang_disposeTokens( instance->translationUnit, cursor_token, 1 );
-                    return CXChildVisit_Break;
-                }
-            }
-            
-            clang_disposeString( token_spelling );
-            clang_disposeTokens( instance->translationUnit, cursor_token, 1 );
-        }
-
-        clang_disposeString( type_spelling );
-    }
-    return CXChildVisit_Recurse;
-}
-
-CXChildVisitResult SeminalInputFeatureDetector::whileStmtBranch(CXCursor current,
-                                                      CXCursor parent,
-                                                      CXClientData clientData) {
-
-    // instance of SeminalInputFeatureDetector
-    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
-
-    if ( !clang_Cursor_isNull( current ) ) {
-
-        // Cursor Type
-        CXType cursor_type = clang_getCursorType( current );
-        CXString type_spelling = clang_getTypeSpelling( cursor_type );
-
-        // Cursor Location
-        CXSourceLocation location = clang_getCursorLocation( current );
-        unsigned line;
-        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
-        line += instance->kpc->getNumIncludeDirectives();
-        
-        if ( ( parent.kind == CXCursor_BinaryOperator || parent.kind == CXCursor_CallExpr ) && current.kind == CXCursor_UnexposedExpr ) {
-            // Cursor Token
-            CXToken *cursor_token = clang_getToken( instance->kpc->getTU(), location );
-            if ( cursor_token ) {
-                CXString token_spelling = clang_getTokenSpelling( instance->kpc->getTU(), *cursor_token );
-                if ( instance->debug ) {
-                    // Cursor Kind
-                    CXString parent_kind_spelling = clang_getCursorKindSpelling( parent.kind );
-                    CXString current_kind_spelling = clang_getCursorKindSpelling( current.kind );
-
-                    std::cout << "  Kind: " << clang_getCString(parent_kind_spelling) << "\n"
-                            << "    Kind: " << clang_getCString(current_kind_spelling) << "\n"
-                            << "      Type: " << clang_getCString(type_spelling) << "\n"
-                            << "      Token: " << clang_getCString(token_spelling) << "\n"
-                            << "      Line " << line << "\n\n";
-
-                    clang_disposeString( parent_kind_spelling );
-                    clang_disposeString( current_kind_spelling );
-                }
-
-                instance->getDeclLocation( clang_getCString(token_spelling), instance->count++, clang_getCString(type_spelling) );
-                clang_disposeString( token_spelling );
-                clang_disposeTokens( instance->translationUnit, cursor_token, 1 );
-                return CXChildVisit_Break;
-            }
-        }
-
-        clang_disposeString( type_spelling );
-    }
-    return CXChildVisit_Recurse;
-}
-
-
-
-void SeminalInputFeatureDetector::getDeclLocation( std::string name, int index, std::string type ) {
-    
-    // Check if variable already exists in the vector of SeminalInputFeatures
-    bool exists = false;
-    for ( int i = 0; i < SeminalInputFeatures.size(); i++ ) {
-        if ( SeminalInputFeatures[ i ].name == name ) {
-            exists = true;
-        }
-    }
-
-    // Check if variable exists in the map of variable declarations
-    std::map<std::string, unsigned>::iterator it;
-    it = varDecls.find( name );
-    if ( !exists ) {
-        if ( it != varDecls.end() ) {
-            temp.name = it->first;
-            temp.line = it->second;
-            temp.type = type;
-            SeminalInputFeatures.push_back( temp );
-        } else if ( debug ) {
-            std::cout << "Variable was not found.\n\n";
-        }
-    } else if ( debug ) {
-        std::cout << "Variable is already accounted for.\n\n";
-    }
-}
-
-void SeminalInputFeatureDetector::printSeminalInputFeatures() {
-    for ( int i = 0; i < SeminalInputFeatures.size(); i++ ) {
-        if ( SeminalInputFeatures[ i ].type == "FILE *" ) {
-            std::cout << "Line " << SeminalInputFeatures[ i ].line << ": size of file "
-                  << SeminalInputFeatures[ i ].name << "\n";
-        } else {
-            std::cout << "Line " << SeminalInputFeatures[ i ].line << ": "
-                  << SeminalInputFeatures[ i ].name << "\n";
-        }
-    }
-}
-
-void SeminalInputFeatureDetector::cursorFinder() {
-
-    // DEBUGGING: printing out list of variable declarations
-    if ( debug ) {
-        std::cout << "Variable Declarations: \n";
-        for( const std::pair<std::string, unsigned> var : varDecls ) {
-            std::cout << var.second << ": " << var.first << "\n";
-        }
-        std::cout << "\n";
-    }
-
-    // Looks at each of the cursor objects to recursively search through
-    for ( int i = 0; i < cursorObjs.size(); i++ ) {
-
-        if ( !clang_Cursor_isNull( cursorObjs[i] ) ) {
-            if ( debug ) {
-                CXString kind_spelling = clang_getCursorKindSpelling( cursorObjs[i].kind );
-                std::cout << "Kind: " << clang_getCString(kind_spelling) << "\n";
-                clang_disposeString( kind_spelling );
-            }
-
-            switch ( cursorObjs[i].kind ) {
-                case CXCursor_IfStmt:
-                    clang_visitChildren( cursorObjs[i], this->ifStmtBranch, this );
-                    break;
-                case CXCursor_ForStmt:
-                    clang_visitChildren( cursorObjs[i], this->forStmtBranch, this );
-                    break;
-                case CXCursor_WhileStmt:
-                    clang_visitChildren( cursorObjs[i], this->whileStmtBranch, this );
-                    break;
-                default:
-                    break;
-            }
-
-            if ( debug ) {
-                std::cout << "\n";
-            }
-        }
-    }
-
-    clang_disposeTranslationUnit( translationUnit );
-    clang_disposeIndex( index );
-    delete kpc;
-
-    printSeminalInputFeatures();
-}
-
-void SeminalInputFeatureDetector::findCursorAtLine( int branchLine ) {
-
-    if ( branchLine != -1 ) {
-    
-        CXSourceLocation location;
-        unsigned line;
-
-        // Looks at each of the cursor objects to recursively search through
-        for ( int i = 0; i < cursorObjs.size(); i++ ) {
-
-            if ( !clang_Cursor_isNull( cursorObjs[i] ) ) {
-                if ( debug ) {
-                    CXString kind_spelling = clang_getCursorKindSpelling( cursorObjs[i].kind );
-                    std::cout << "Kind: " << clang_getCString(kind_spelling) << "\n";
-                    clang_disposeString( kind_spelling );
-                }
-
-                // Cursor Location
-                location = clang_getCursorLocation( cursorObjs[i] );
-                clang_getExpansionLocation( location, &cxFile, &line, nullptr, nullptr );
-                line += kpc->getNumIncludeDirectives();
-
-                if ( line == branchLine ) {
-                    switch ( cursorObjs[i].kind ) {
-                        case CXCursor_IfStmt:
-                            clang_visitChildren( cursorObjs[i], this->ifStmtBranch, this );
-                            break;
-                        case CXCursor_ForStmt:
-                            clang_visitChildren( cursorObjs[i], this->forStmtBranch, this );
-                            break;
-                        case CXCursor_WhileStmt:
-                            clang_visitChildren( cursorObjs[i], this->whileStmtBranch, this );
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-                }
-
-                if ( debug ) {
-                    std::cout << "\n";
-                }
-            }
-        }
-
-    } else {
-        std::cout << "No branch points detected.\n";
-    }
-
-    clang_disposeTranslationUnit( translationUnit );
-    clang_disposeIndex( index );
-    delete kpc;
-
-    printSeminalInputFeatures();
-}
+/** 
+ * SeminalInputFeatureDetector.cpp
+ * @author Carter Fultz (cmfultz)
+*/
+
+#include "SeminalInputFeatureDetector.h"
+#include "SeedHintExporter.h"
+#include "CursorSite.h"
+#include "ConditionCollector.h"
+#include "ProbeInstrumenter.h"
+
+#include <clang-c/Index.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+SeminalInputFeatureDetector::SeminalInputFeatureDetector( const std::string &filename, bool debug,
+                                                          const DetectorOptions &options,
+                                                          const std::vector<std::string> &compileArgs )
+    : index(ClangIndex::create()), compileArgs(compileArgs), debug(debug), options(options) {
+    load( filename );
+}
+
+void SeminalInputFeatureDetector::load( const std::string &fileName ) {
+
+    filename = fileName;
+    budget.start( options.timeBudget, options.memoryBudget );
+
+    // Get a pointer to the KPC, the cursors obtained from this are need their
+    // translation unit to still be active in memory to be able to obtain
+    // valid memory reads and prevent heap corruption.
+    kpc = std::make_unique<KeyPointsCollector>( filename, false );
+    
+    // Obtained from part 1, KeyPointsCollector.cpp
+    kpc->collectCursors();
+    cursorObjs = kpc->getCursorObjs();
+    varDecls = kpc->getVarDecls();
+    count = 0;
+
+    // The KPC already parsed the same file with the same (empty) arguments, so
+    // its translation unit can serve the whole analysis
+    parseReport = ParseReport();
+    unitShift = 0;
+    if ( options.singleParse && compileArgs.empty() ) {
+        // Its diagnostics are mostly the missing headers, not the file's
+        translationUnit = kpc->getTU();
+        unitShift = kpc->getNumIncludeDirectives();
+        parseReport.counted = false;
+    } else if ( budget.exhausted( true ) ) {
+        // The KPC's parse used up the budget, a second parse would only add to
+        // it. Without a translation unit of our own nothing is traversed.
+        translationUnit = nullptr;
+        parseReport.counted = false;
+    } else {
+        std::vector<const char *> args;
+        for ( const std::string &arg : compileArgs ) {
+            args.push_back( arg.c_str() );
+        }
+
+        CXTranslationUnit unit = nullptr;
+        CXErrorCode error =
+            clang_parseTranslationUnit2( index.get(), filename.c_str(), args.data(), args.size(),
+                                        nullptr, 0, CXTranslationUnit_None, &unit );
+        ownTranslationUnit.reset( error == CXError_Success ? unit : nullptr );
+        translationUnit = ownTranslationUnit.get();
+        parseReport.failed = !translationUnit;
+        countDiagnostics();
+    }
+    cxFile = translationUnit ? clang_getFile( translationUnit, filename.c_str() ) : nullptr;
+
+    cursorUnit = kpc->getTU();
+    lineShift = kpc->getNumIncludeDirectives();
+    if ( !compileArgs.empty() && translationUnit ) {
+        relocateCursors();
+    }
+}
+
+void SeminalInputFeatureDetector::relocateCursors() {
+
+    // Branches the flags compile out have no counterpart and are dropped
+    std::vector<CXCursor> relocated;
+    relocated.reserve( cursorObjs.size() );
+    for ( const CXCursor &cursor : cursorObjs ) {
+        CXCursor found = CursorSite::of( cursor, lineShift ).find( translationUnit, cxFile );
+        if ( !clang_Cursor_isNull( found ) ) {
+            relocated.push_back( found );
+        }
+    }
+
+    if ( debug ) {
+        std::cout << relocated.size() << " of " << cursorObjs.size()
+                  << " branch points found in the parse with compile flags\n\n";
+    }
+
+    cursorObjs.swap( relocated );
+    cursorUnit = translationUnit;
+    lineShift = 0;
+}
+
+void SeminalInputFeatureDetector::countDiagnostics() {
+
+    if ( !translationUnit ) {
+        return;
+    }
+    unsigned numDiagnostics = clang_getNumDiagnostics( translationUnit );
+    for ( unsigned i = 0; i < numDiagnostics; i++ ) {
+        CXDiagnostic diagnostic = clang_getDiagnostic( translationUnit, i );
+        CXDiagnosticSeverity severity = clang_getDiagnosticSeverity( diagnostic );
+        if ( severity >= CXDiagnostic_Error ) {
+            parseReport.errors++;
+        } else if ( severity == CXDiagnostic_Warning ) {
+            parseReport.warnings++;
+        }
+
+        if ( debug && severity >= CXDiagnostic_Warning ) {
+            ClangString text( clang_formatDiagnostic( diagnostic, clang_defaultDiagnosticDisplayOptions() ) );
+            std::cout << text.c_str() << "\n";
+        }
+        clang_disposeDiagnostic( diagnostic );
+    }
+}
+
+void SeminalInputFeatureDetector::release() {
+    cursorObjs.clear();
+    cursorUnit = nullptr;
+    translationUnit = nullptr;
+    ownTranslationUnit.reset();
+    kpc.reset();
+}
+
+void SeminalInputFeatureDetector::reset( const std::string &fileName, const std::vector<std::string> &compileArgs ) {
+
+    // Cursors point into the old translation units, drop them before anything else
+    release();
+    SeminalInputFeatures.clear();
+    varDecls.clear();
+    branchReports.clear();
+    probePlan = ProbePlan();
+    temp = SeminalInputFeature();
+    this->compileArgs = compileArgs;
+    load( fileName );
+}
+
+
+
+CXChildVisitResult SeminalInputFeatureDetector::ifStmtBranch(CXCursor current,
+                                                      CXCursor parent,
+                                                      CXClientData clientData) {
+
+    // instance of SeminalInputFeatureDetector
+    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
+
+    if ( instance->budget.exhausted() ) {
+        return CXChildVisit_Break;
+    }
+
+    if ( !clang_Cursor_isNull( current ) ) {
+
+        // Cursor Type
+        CXType cursor_type = clang_getCursorType( current );
+        ClangString type_spelling( clang_getTypeSpelling( cursor_type ) );
+
+        // Cursor Location
+        CXSourceLocation location = clang_getCursorLocation( current );
+        unsigned line;
+        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
+        line += instance->lineShift;
+        
+        // Cursor Token
+        ClangTokens cursor_token = ClangTokens::at( instance->cursorUnit, location );
+        if ( !cursor_token.empty() ) {
+            ClangString token_spelling = cursor_token.spelling( 0 );
+
+            if ( parent.kind == CXCursor_IfStmt && ( current.kind == CXCursor_UnexposedExpr 
+                                                || current.kind == CXCursor_BinaryOperator ) ) {
+                if ( instance->debug ) {
+                    ClangString parent_kind_spelling( clang_getCursorKindSpelling( parent.kind ) );
+                    ClangString current_kind_spelling( clang_getCursorKindSpelling( current.kind ) );
+
+                    std::cout << "  Kind: " << parent_kind_spelling.c_str() << "\n"
+                              << "    Kind: " << current_kind_spelling.c_str() << "\n"
+                              << "      Type: " << type_spelling.c_str() << "\n"
+                              << "      Token: " << token_spelling.c_str() << "\n"
+                              << "      Line " << line << "\n\n";
+                }
+
+                instance->getDeclLocation( token_spelling.str(), instance->count++, type_spelling.str() );
+                return CXChildVisit_Break;
+            }
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+CXChildVisitResult SeminalInputFeatureDetector::forStmtBranch(CXCursor current,
+                                                      CXCursor parent,
+                                                      CXClientData clientData) {
+
+    // instance of SeminalInputFeatureDetector
+    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
+
+    if ( instance->budget.exhausted() ) {
+        return CXChildVisit_Break;
+    }
+
+    if ( !clang_Cursor_isNull( current ) ) {
+        
+        // Cursor Type
+        CXType cursor_type = clang_getCursorType( current );
+        ClangString type_spelling( clang_getTypeSpelling( cursor_type ) );
+
+        // Cursor Location
+        CXSourceLocation location = clang_getCursorLocation( current );
+        unsigned line;
+        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
+        line += instance->lineShift;
+
+        // Cursor Token
+        ClangTokens cursor_token = ClangTokens::at( instance->cursorUnit, location );
+        if ( !cursor_token.empty() ) {
+            ClangString token_spelling = cursor_token.spelling( 0 );
+
+            if ( (parent.kind == CXCursor_DeclStmt && current.kind == CXCursor_VarDecl) || (current.kind == CXCursor_DeclRefExpr) ) {
+                if ( instance->debug ) {
+                    ClangString parent_kind_spelling( clang_getCursorKindSpelling( parent.kind ) );
+                    ClangString current_kind_spelling( clang_getCursorKindSpelling( current.kind ) );
+
+                    std::cout << "  Kind: " << parent_kind_spelling.c_str() << "\n"
+                              << "    Kind: " << current_kind_spelling.c_str() << "\n"
+                              << "      Type: " << type_spelling.c_str() << "\n"
+                              << "      Token: " << token_spelling.c_str() << "\n"
+                              << "      Line " << line << "\n\n";
+                }
+
+                instance->temp.name = token_spelling.str();
+            }
+            
+            if ( ( parent.kind == CXCursor_BinaryOperator || parent.kind == CXCursor_CallExpr ) && current.kind == CXCursor_UnexposedExpr ) {
+                if ( instance->debug ) {
+                    ClangString parent_kind_spelling( clang_getCursorKindSpelling( parent.kind ) );
+                    ClangString current_kind_spelling( clang_getCursorKindSpelling( current.kind ) );
+
+                    std::cout << "  Kind: " << parent_kind_spelling.c_str() << "\n"
+                              << "    Kind: " << current_kind_spelling.c_str() << "\n"
+                              << "      Type: " << type_spelling.c_str() << "\n"
+                              << "      Token: " << token_spelling.c_str() << "\n"
+                              << "      Line " << line << "\n\n";
+                }
+
+                if ( instance->temp.name != token_spelling.c_str() ) {
+                    instance->getDeclLocation( token_spelling.str(), instance->count++, type_spelling.str() );
+                    return CXChildVisit_Break;
+                }
+            }
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+CXChildVisitResult SeminalInputFeatureDetector::whileStmtBranch(CXCursor current,
+                                                      CXCursor parent,
+                                                      CXClientData clientData) {
+
+    // instance of SeminalInputFeatureDetector
+    SeminalInputFeatureDetector *instance = static_cast<SeminalInputFeatureDetector *>(clientData);
+
+    if ( instance->budget.exhausted() ) {
+        return CXChildVisit_Break;
+    }
+
+    if ( !clang_Cursor_isNull( current ) ) {
+
+        // Cursor Type
+        CXType cursor_type = clang_getCursorType( current );
+        ClangString type_spelling( clang_getTypeSpelling( cursor_type ) );
+
+        // Cursor Location
+        CXSourceLocation location = clang_getCursorLocation( current );
+        unsigned line;
+        clang_getExpansionLocation( location, &instance->cxFile, &line, nullptr, nullptr );
+        line += instance->lineShift;
+        
+        if ( ( parent.kind == CXCursor_BinaryOperator || parent.kind == CXCursor_CallExpr ) && current.kind == CXCursor_UnexposedExpr ) {
+            // Cursor Token
+            ClangTokens cursor_token = ClangTokens::at( instance->cursorUnit, location );
+            if ( !cursor_token.empty() ) {
+                ClangString token_spelling = cursor_token.spelling( 0 );
+                if ( instance->debug ) {
+                    // Cursor Kind
+                    ClangString parent_kind_spelling( clang_getCursorKindSpelling( parent.kind ) );
+                    ClangString current_kind_spelling( clang_getCursorKindSpelling( current.kind ) );
+
+                    std::cout << "  Kind: " << parent_kind_spelling.c_str() << "\n"
+                            << "    Kind: " << current_kind_spelling.c_str() << "\n"
+                            << "      Type: " << type_spelling.c_str() << "\n"
+                            << "      Token: " << token_spelling.c_str() << "\n"
+                            << "      Line " << line << "\n\n";
+                }
+
+                instance->getDeclLocation( token_spelling.str(), instance->count++, type_spelling.str() );
+                return CXChildVisit_Break;
+            }
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+
+
+void SeminalInputFeatureDetector::reportConditions( CXCursor branch ) {
+
+    for ( const ConditionOperand &operand : ConditionCollector::collect( cursorUnit, branch ) ) {
+        // Identifiers of an unresolved condition only count if they are variables
+        if ( operand.fromTokens && !varDecls.count( operand.name ) ) {
+            continue;
+        }
+        if ( debug ) {
+            std::cout << "  Operand: " << operand.name << "\n"
+                      << "    Context: " << ( operand.context.empty() ? "(condition)" : operand.context ) << "\n"
+                      << "      Type: " << operand.type << "\n"
+                      << "      Line " << operand.line + lineShift << "\n\n";
+        }
+        getDeclLocation( operand.name, count++, operand.type );
+    }
+}
+
+void SeminalInputFeatureDetector::getDeclLocation( std::string name, int index, std::string type ) {
+
+    // Every branch a name is reported by counts towards its influence, even
+    // when the feature itself is already known
+    if ( options.rankByInfluence ) {
+        hotness.attribute( name );
+    }
+    if ( probing ) {
+        branchReports.emplace_back( currentBranch, name );
+    }
+
+    // Check if variable already exists in the vector of SeminalInputFeatures
+    bool exists = false;
+    for ( int i = 0; i < SeminalInputFeatures.size(); i++ ) {
+        if ( SeminalInputFeatures[ i ].name == name ) {
+            exists = true;
+        }
+    }
+
+    // Check if variable exists in the map of variable declarations
+    std::map<std::string, unsigned>::iterator it;
+    it = varDecls.find( name );
+    if ( !exists ) {
+        if ( it != varDecls.end() ) {
+            temp.name = it->first;
+            temp.line = it->second;
+            temp.type = type;
+            SeminalInputFeatures.push_back( temp );
+        } else if ( debug ) {
+            std::cout << "Variable was not found.\n\n";
+        }
+    } else if ( debug ) {
+        std::cout << "Variable is already accounted for.\n\n";
+    }
+}
+
+void SeminalInputFeatureDetector::exportSeedHints() {
+
+    // Reuses the translation unit of this run, no extra parse
+    SeedHintExporter exporter( translationUnit, filename, unitShift );
+    exporter.collectInputSources();
+    exporter.exportHints( SeminalInputFeatures, seedHintDir );
+
+    if ( debug ) {
+        std::cout << "Input sources:\n";
+        for ( const SeedHintExporter::InputSource &source : exporter.getInputSources() ) {
+            std::cout << "  Line " << source.line << ": " << source.variable << " <- "
+                      << source.function << "(" << source.stream << ")\n";
+        }
+        std::cout << "\n";
+    }
+}
+
+void SeminalInputFeatureDetector::printSeminalInputFeatures() {
+    for ( int i = 0; i < SeminalInputFeatures.size(); i++ ) {
+        if ( SeminalInputFeatures[ i ].type == "FILE *" ) {
+            std::cout << "Line " << SeminalInputFeatures[ i ].line << ": size of file "
+                  << SeminalInputFeatures[ i ].name << "\n";
+        } else {
+            std::cout << "Line " << SeminalInputFeatures[ i ].line << ": "
+                  << SeminalInputFeatures[ i ].name << "\n";
+        }
+    }
+}
+
+void SeminalInputFeatureDetector::cursorFinder() {
+
+    // DEBUGGING: printing out list of variable declarations
+    if ( debug ) {
+        std::cout << "Variable Declarations: \n";
+        for( const std::pair<std::string, unsigned> var : varDecls ) {
+            std::cout << var.second << ": " << var.first << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    if ( options.rankByInfluence ) {
+        hotness.prepare( cursorObjs );
+    }
+
+    // Looks at each of the cursor objects to recursively search through
+    for ( int i = 0; i < cursorObjs.size() && !budget.exhausted(); i++ ) {
+
+        if ( !clang_Cursor_isNull( cursorObjs[i] ) ) {
+            if ( debug ) {
+                ClangString kind_spelling( clang_getCursorKindSpelling( cursorObjs[i].kind ) );
+                std::cout << "Kind: " << kind_spelling.c_str() << "\n";
+            }
+            enterBranch( i );
+
+            if ( options.completeConditions ) {
+                reportConditions( cursorObjs[i] );
+            } else switch ( cursorObjs[i].kind ) {
+                case CXCursor_IfStmt:
+                    clang_visitChildren( cursorObjs[i], this->ifStmtBranch, this );
+                    break;
+                case CXCursor_ForStmt:
+                    clang_visitChildren( cursorObjs[i], this->forStmtBranch, this );
+                    break;
+                case CXCursor_WhileStmt:
+                    clang_visitChildren( cursorObjs[i], this->whileStmtBranch, this );
+                    break;
+                default:
+                    break;
+            }
+
+            if ( debug ) {
+                std::cout << "\n";
+            }
+        }
+    }
+
+    if ( options.rankByInfluence ) {
+        rankFeatures();
+    }
+
+    // The exporter walks the whole translation unit, not worth it for a file
+    // that is already over budget
+    if ( !seedHintDir.empty() && !isTruncated() ) {
+        exportSeedHints();
+    }
+
+    if ( probing ) {
+        planProbes();
+    }
+
+    release();
+
+    printSeminalInputFeatures();
+}
+
+void SeminalInputFeatureDetector::enterBranch( size_t index ) {
+    currentBranch = index;
+    hotness.enterBranch( index );
+}
+
+void SeminalInputFeatureDetector::planProbes() {
+
+    probePlan = ProbePlan();
+    ProbeInstrumenter instrumenter( filename, cursorUnit, lineShift );
+    if ( !cursorUnit || !instrumenter.loadSource() ) {
+        return;
+    }
+
+    // Features of each branch, in report order. Names without a declaration
+    // never became features and get no probe.
+    std::map<size_t, std::vector<std::string>> branchFeatures;
+    for ( const auto &[branch, name] : branchReports ) {
+        if ( branch >= cursorObjs.size() || !varDecls.count( name ) ) {
+            continue;
+        }
+        std::vector<std::string> &names = branchFeatures[ branch ];
+        if ( std::find( names.begin(), names.end(), name ) == names.end() ) {
+            names.push_back( name );
+        }
+    }
+    for ( const auto &[branch, names] : branchFeatures ) {
+        if ( !instrumenter.addBranch( cursorObjs[ branch ], names ) && debug ) {
+            std::cout << "No probe for the branch of " << names.front() << "\n";
+        }
+    }
+
+    std::vector<std::pair<std::string, unsigned>> declarations;
+    for ( const SeminalInputFeature &feature : SeminalInputFeatures ) {
+        declarations.emplace_back( feature.name, feature.line );
+    }
+    instrumenter.addDeclarations( declarations );
+
+    probePlan = instrumenter.plan();
+}
+
+void SeminalInputFeatureDetector::rankFeatures() {
+
+    std::stable_sort( SeminalInputFeatures.begin(), SeminalInputFeatures.end(),
+                      [&]( const SeminalInputFeature &a, const SeminalInputFeature &b ) {
+                          return hotness.influenceOf( a.name ) > hotness.influenceOf( b.name );
+                      } );
+
+    // DEBUGGING: what the ranking is based on
+    if ( debug ) {
+        std::cout << "Influence:\n";
+        for ( const SeminalInputFeature &feature : SeminalInputFeatures ) {
+            const HotnessRanker::Score *score = hotness.scoreOf( feature.name );
+            if ( score ) {
+                std::cout << "  " << feature.name << ": " << score->influence << " (" << score->branches
+                          << " branches, bounds " << score->loopBounds << " loops, depth " << score->maxDepth
+                          << ", " << score->codeSize << " bytes)\n";
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+void SeminalInputFeatureDetector::findCursorAtLine( int branchLine ) {
+
+    // Ranked the same as in cursorFinder, only the branch on the line contributes
+    if ( options.rankByInfluence ) {
+        hotness.prepare( cursorObjs );
+    }
+
+    if ( branchLine != -1 ) {
+    
+        CXSourceLocation location;
+        unsigned line;
+
+        // Looks at each of the cursor objects to recursively search through
+        for ( int i = 0; i < cursorObjs.size() && !budget.exhausted(); i++ ) {
+
+            if ( !clang_Cursor_isNull( cursorObjs[i] ) ) {
+                if ( debug ) {
+                    ClangString kind_spelling( clang_getCursorKindSpelling( cursorObjs[i].kind ) );
+                    std::cout << "Kind: " << kind_spelling.c_str() << "\n";
+                }
+
+                // Cursor Location
+                location = clang_getCursorLocation( cursorObjs[i] );
+                clang_getExpansionLocation( location, &cxFile, &line, nullptr, nullptr );
+                line += lineShift;
+
+                if ( line == branchLine ) {
+                    enterBranch( i );
+                    if ( options.completeConditions ) {
+                        reportConditions( cursorObjs[i] );
+                    } else switch ( cursorObjs[i].kind ) {
+                        case CXCursor_IfStmt:
+                            clang_visitChildren( cursorObjs[i], this->ifStmtBranch, this );
+                            break;
+                        case CXCursor_ForStmt:
+                            clang_visitChildren( cursorObjs[i], this->forStmtBranch, this );
+                            break;
+                        case CXCursor_WhileStmt:
+                            clang_visitChildren( cursorObjs[i], this->whileStmtBranch, this );
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+                }
+
+                if ( debug ) {
+                    std::cout << "\n";
+                }
+            }
+        }
+
+    } else {
+        std::cout << "No branch points detected.\n";
+    }
+
+    if ( options.rankByInfluence ) {
+        rankFeatures();
+    }
+
+    // The exporter walks the whole translation unit, not worth it for a file
+    // that is already over budget
+    if ( !seedHintDir.empty() && !isTruncated() ) {
+        exportSeedHints();
+    }
+
+    if ( probing ) {
+        planProbes();
+    }
+
+    release();
+
+    printSeminalInputFeatures();
+}
@@ -1,79 +1,213 @@
-/** 
- * SeminalInputFeatureDetector.h
- * @author Carter Fultz (cmfultz)
-*/
-
-#include "KeyPointsCollector.h"
-#include <string>
-#include <vector>
-#include <map>
-#include <clang-c/Index.h>
-
-class SeminalInputFeatureDetector {
-
-    // Name of file we are analyzing
-    std::string filename;
-
-    // CXFile object of analysis file.
-    CXFile cxFile;
-
-    // Instance of KeyPointsCollector
-    KeyPointsCollector *kpc; 
-
-    // Vector of CXCursor objs pointing to node of interest
-    std::vector<CXCursor> cursorObjs;
-
-    // Index - set of translation units that would be linked together as an exe
-    // Ref ^ https://clang.llvm.org/docs/LibClang.html
-    // Marked as static as there could be multiple KPC objects for files that need
-    // to be grouped together.
-    inline static CXIndex index = clang_createIndex(0, 0);
-
-    // Top level translation unit of the source file.
-    CXTranslationUnit translationUnit;
-
-    // Recursive searches through branches
-    static CXChildVisitResult ifStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
-    static CXChildVisitResult forStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
-    static CXChildVisitResult whileStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
-
-    // Information struct for a Seminal Input Feature
-    struct SeminalInputFeature {
-        std::string name;
-        unsigned line;
-        std::string type;
-    };
-
-    // *All obtained from KeyPointsCollector*
-    // Vector of completed branch points
-    std::vector<SeminalInputFeature> SeminalInputFeatures;
-    // Number of SeminalInputFeatures in the vector
-    unsigned count;
-    
-    // Map of variable names (VarDecls) mapped to their declaration location
-    std::map<std::string, unsigned> varDecls;
-
-    // Temp value for storing Seminal Input Features
-    SeminalInputFeature temp;
-
-    // Updates the Seminal Input Features with their declare locations
-    void getDeclLocation( std::string name, int index, std::string type );
-    
-    // Function to print the Seminal Input Features
-    void printSeminalInputFeatures();
-
-    // debug boolean value used to print out statements
-    bool debug;
-
-public:
-
-    // SeminalInputFeatureDetector(const std::string &fileName);
-    SeminalInputFeatureDetector( const std::string &fileName, bool debug = false );
-
-    // Looks through the vector of CXCursors
-    void cursorFinder();
-
-    // Locates the Seminal Input Feature at a specific branch
-    void findCursorAtLine( int branchLine );
-
-};
+/** 
+ * SeminalInputFeatureDetector.h
+ * @author Carter Fultz (cmfultz)
+*/
+
+#pragma once
+
+#include "KeyPointsCollector.h"
+#include "ClangHandles.h"
+#include "Budget.h"
+#include "HotnessRanker.h"
+#include "ProbeInstrumenter.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <clang-c/Index.h>
+
+// Engine settings that change how the analysis runs but not what it reports
+struct DetectorOptions {
+    // Reuse the KeyPointsCollector translation unit instead of parsing the file a
+    // second time. Ignored for files with compile arguments, the KPC parses without them.
+    // The KPC parses the file with its #include lines removed, so everything read
+    // from that translation unit is shifted by getNumIncludeDirectives() lines.
+    bool singleParse = false;
+    // Report every variable of a branch condition (ConditionCollector) instead
+    // of the first one the branch visitors match
+    bool completeConditions = false;
+    // Per file budgets, 0 is unlimited. Parsing cannot be interrupted, the
+    // traversal stops where the budget runs out and the file is truncated.
+    double timeBudget = 0;
+    size_t memoryBudget = 0;
+    // Order the features by their estimated influence (HotnessRanker) instead
+    // of the order they were found in
+    bool rankByInfluence = false;
+};
+
+class SeminalInputFeatureDetector {
+
+public:
+
+    // Information struct for a Seminal Input Feature
+    struct SeminalInputFeature {
+        std::string name;
+        unsigned line;
+        std::string type;
+    };
+
+    // Diagnostics of the detector's parse of the current file
+    struct ParseReport {
+        unsigned errors = 0;
+        unsigned warnings = 0;
+        // libclang could not produce a translation unit at all
+        bool failed = false;
+        // False when the file itself was not parsed (single parse mode reuses
+        // the KPC's copy without includes), errors and warnings are unknown
+        bool counted = true;
+    };
+
+private:
+
+    // Name of file we are analyzing
+    std::string filename;
+
+    // CXFile object of analysis file.
+    CXFile cxFile;
+
+    // Instance of KeyPointsCollector
+    std::unique_ptr<KeyPointsCollector> kpc;
+
+    // Vector of CXCursor objs pointing to node of interest
+    std::vector<CXCursor> cursorObjs;
+
+    // Translation unit cursorObjs belong to, and what to add to its lines to get
+    // the lines of the file. The KPC's unless the cursors were moved to our parse.
+    CXTranslationUnit cursorUnit;
+    unsigned lineShift;
+
+    // Index - set of translation units that would be linked together as an exe
+    // Ref ^ https://clang.llvm.org/docs/LibClang.html
+    // One per detector and kept across reset() so a reused detector never
+    // touches an index that another instance already disposed.
+    ClangIndex index;
+
+    // Translation unit this detector parsed itself, empty in single parse mode.
+    // Declared after the index so it is disposed first.
+    ClangTranslationUnit ownTranslationUnit;
+
+    // Top level translation unit of the source file (ours or the KPC's), and
+    // what to add to its lines to get the lines of the file
+    CXTranslationUnit translationUnit;
+    unsigned unitShift;
+
+    // Compiler arguments of the current file (-I, -D, -std, ...)
+    std::vector<std::string> compileArgs;
+
+    // Diagnostics counts of the current file
+    ParseReport parseReport;
+
+    // Parses fileName and collects its cursors, the index and buffers are reused
+    void load( const std::string &fileName );
+
+    // Counts the diagnostics of translationUnit into parseReport
+    void countDiagnostics();
+
+    // Moves cursorObjs into our own translation unit, the KPC cannot parse with compileArgs
+    void relocateCursors();
+
+    // Frees the translation units of the current file
+    void release();
+
+    // Recursive searches through branches
+    static CXChildVisitResult ifStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
+    static CXChildVisitResult forStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
+    static CXChildVisitResult whileStmtBranch(CXCursor current, CXCursor parent, CXClientData clientData);
+
+    // *All obtained from KeyPointsCollector*
+    // Vector of completed branch points
+    std::vector<SeminalInputFeature> SeminalInputFeatures;
+    // Number of SeminalInputFeatures in the vector
+    unsigned count;
+    
+    // Map of variable names (VarDecls) mapped to their declaration location
+    std::map<std::string, unsigned> varDecls;
+
+    // Temp value for storing Seminal Input Features
+    SeminalInputFeature temp;
+
+    // Reports every variable in the condition of branch, completeConditions mode
+    void reportConditions( CXCursor branch );
+
+    // Updates the Seminal Input Features with their declare locations
+    void getDeclLocation( std::string name, int index, std::string type );
+    
+    // Function to print the Seminal Input Features
+    void printSeminalInputFeatures();
+
+    // debug boolean value used to print out statements
+    bool debug;
+
+    // Engine settings
+    DetectorOptions options;
+
+    // Budget of the current file, polled by the visitors
+    Budget budget;
+
+    // Influence of the features, filled during the traversal when ranking
+    HotnessRanker hotness;
+
+    // Sorts the features by influence, most influential first
+    void rankFeatures();
+
+    // Index in cursorObjs of the branch being traversed
+    size_t currentBranch = 0;
+
+    // The traversal moves on to cursorObjs[index]
+    void enterBranch( size_t index );
+
+    // Instrument the file for dynamic validation during the analysis
+    bool probing = false;
+
+    // Every report of the traversal, branch index and name, when probing
+    std::vector<std::pair<size_t, std::string>> branchReports;
+
+    // Instrumented source of the last file, empty when probing is off
+    ProbePlan probePlan;
+
+    // Puts probes on the branches that reported features and on the feature
+    // declarations, must run while cursorUnit is still alive
+    void planProbes();
+
+    // Directory for fuzzer seed hints, empty when the export is off
+    std::string seedHintDir;
+
+    // Maps the features back to their input sources and writes the hint files,
+    // must run while the translation unit is still alive
+    void exportSeedHints();
+
+public:
+
+    // SeminalInputFeatureDetector(const std::string &fileName);
+    SeminalInputFeatureDetector( const std::string &fileName, bool debug = false,
+                                 const DetectorOptions &options = DetectorOptions(),
+                                 const std::vector<std::string> &compileArgs = {} );
+
+    // Switches the detector to another file, keeping its index and buffers
+    void reset( const std::string &fileName, const std::vector<std::string> &compileArgs = {} );
+
+    // Looks through the vector of CXCursors
+    void cursorFinder();
+
+    // Locates the Seminal Input Feature at a specific branch
+    void findCursorAtLine( int branchLine );
+
+    // Also write a fuzzing dictionary and priority list to outDir during the analysis
+    void setSeedHintOutput( const std::string &outDir ) { seedHintDir = outDir; }
+
+    // Also instrument the file for DynamicValidator during the analysis
+    void enableProbes() { probing = true; }
+
+    // Instrumented source of the last cursorFinder()/findCursorAtLine() call
+    const ProbePlan &getProbePlan() const { return probePlan; }
+
+    const ParseReport &getParseReport() const { return parseReport; }
+
+    // Features found by the last cursorFinder()/findCursorAtLine() call
+    const std::vector<SeminalInputFeature> &getSeminalInputFeatures() const { return SeminalInputFeatures; }
+
+    // The budget ran out before the current file was done, its features are partial
+    bool isTruncated() const { return budget.reason() != Budget::None; }
+    const Budget &getBudget() const { return budget; }
+
+};
@@ -0,0 +1,273 @@
+/**
+ * ShardRunner.cpp
+*/
+
+#include "ShardRunner.h"
+#include "ResultFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+ShardRunner::ShardRunner( const std::string &program, const std::vector<std::string> &engineArgs,
+                          const std::string &shardDir )
+    : program(program), engineArgs(engineArgs), shardDir(shardDir) {}
+
+void ShardRunner::addFile( const std::string &file ) {
+    files.push_back( file );
+}
+
+bool ShardRunner::readManifest( const std::string &manifest, std::vector<std::string> &paths ) {
+    std::ifstream in( manifest );
+    if ( !in ) {
+        return false;
+    }
+    std::string line;
+    while ( std::getline( in, line ) ) {
+        line.erase( 0, line.find_first_not_of( " \t" ) );
+        line.erase( line.find_last_not_of( " \t\r" ) + 1 );
+        if ( !line.empty() && line[0] != '#' ) {
+            paths.push_back( line );
+        }
+    }
+    return true;
+}
+
+std::vector<std::vector<std::string>> ShardRunner::partition( unsigned shards ) const {
+
+    std::vector<std::pair<uintmax_t, std::string>> sized;
+    for ( const std::string &file : files ) {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size( file, error );
+        sized.emplace_back( error ? 0 : size, file );
+    }
+    // Largest first, ties by path, so the same manifest always gives the same shards
+    std::sort( sized.begin(), sized.end(), []( const auto &a, const auto &b ) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    } );
+
+    std::vector<std::vector<std::string>> result( std::max( shards, 1u ) );
+    std::vector<uintmax_t> load( result.size(), 0 );
+    for ( const auto &[size, file] : sized ) {
+        size_t shard = std::min_element( load.begin(), load.end() ) - load.begin();
+        result[ shard ].push_back( file );
+        load[ shard ] += std::max<uintmax_t>( size, 1 );
+    }
+    return result;
+}
+
+ShardRunner::ProcessEnd ShardRunner::spawn( const std::vector<std::string> &shardFiles,
+                                            const std::string &resultFile, const std::string &logFile ) const {
+
+    std::vector<std::string> command = { program };
+    command.insert( command.end(), engineArgs.begin(), engineArgs.end() );
+    command.push_back( "--result-file=" + resultFile );
+    command.insert( command.end(), shardFiles.begin(), shardFiles.end() );
+    std::vector<char *> argv;
+    for ( std::string &arg : command ) {
+        argv.push_back( arg.data() );
+    }
+    argv.push_back( nullptr );
+
+    // Results go to the result file, the printed report is not needed
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_addopen( &actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0 );
+    posix_spawn_file_actions_addopen( &actions, STDERR_FILENO, logFile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644 );
+
+    pid_t pid;
+    int spawned = posix_spawn( &pid, program.c_str(), &actions, nullptr, argv.data(), environ );
+    posix_spawn_file_actions_destroy( &actions );
+    if ( spawned != 0 ) {
+        return Crashed;
+    }
+
+    int status;
+    if ( stallTimeout <= 0 ) {
+        waitpid( pid, &status, 0 );
+        return WIFEXITED( status ) && WEXITSTATUS( status ) == 0 ? Finished : Crashed;
+    }
+
+    // Every finished file grows the result file, a process that stops growing it is stuck
+    auto lastProgress = std::chrono::steady_clock::now();
+    uintmax_t lastSize = 0;
+    while ( waitpid( pid, &status, WNOHANG ) == 0 ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size( resultFile, error );
+        if ( !error && size != lastSize ) {
+            lastSize = size;
+            lastProgress = std::chrono::steady_clock::now();
+        } else if ( std::chrono::duration<double>( std::chrono::steady_clock::now() - lastProgress ).count()
+                    > stallTimeout ) {
+            kill( pid, SIGKILL );
+            waitpid( pid, &status, 0 );
+            return Stalled;
+        }
+    }
+    return WIFEXITED( status ) && WEXITSTATUS( status ) == 0 ? Finished : Crashed;
+}
+
+void ShardRunner::runShard( const std::vector<std::string> &shardFiles, const std::string &resultFile,
+                            const std::string &logFile ) const {
+
+    std::vector<std::string> remaining = shardFiles;
+    while ( !remaining.empty() ) {
+        ProcessEnd end = spawn( remaining, resultFile, logFile );
+        if ( end == Finished ) {
+            return;
+        }
+
+        // Files are analyzed in order, whatever is in the result file is done.
+        // A group the process was writing when it died is cut off, otherwise
+        // the reader would stop there and miss everything appended behind it.
+        std::set<std::string> done;
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size( resultFile, error );
+        size_t complete = 0;
+        {
+            ResultReader reader;
+            if ( reader.open( resultFile ) ) {
+                reader.forEach( [&]( const ResultFile::FileView &file ) { done.insert( std::string( file.path ) ); },
+                                []( const ResultFile::FeatureView & ) {} );
+                complete = reader.completeLength();
+            }
+        }
+        if ( !error && complete == 0 ) {
+            // Not even the header made it, the next writer starts the file over
+            std::filesystem::remove( resultFile, error );
+        } else if ( !error && complete < size ) {
+            std::filesystem::resize_file( resultFile, complete, error );
+        }
+        remaining.erase( std::remove_if( remaining.begin(), remaining.end(),
+                                         [&]( const std::string &file ) { return done.count( file ) > 0; } ),
+                         remaining.end() );
+        if ( remaining.empty() ) {
+            return;
+        }
+
+        // The first file left is the one the process died on
+        ResultWriter writer;
+        if ( writer.open( resultFile ) ) {
+            writer.append( remaining.front(), end == Stalled ? ResultFile::TimedOut : ResultFile::Crashed, {} );
+        }
+        if ( end == Stalled ) {
+            std::cerr << remaining.front() << ": analyzer killed after " << stallTimeout
+                      << "s without progress, see " << logFile << "\n";
+        } else {
+            std::cerr << remaining.front() << ": analyzer crashed, see " << logFile << "\n";
+        }
+        remaining.erase( remaining.begin() );
+    }
+}
+
+std::vector<std::string> ShardRunner::run( unsigned shards ) {
+
+    std::error_code error;
+    std::filesystem::create_directories( shardDir, error );
+    if ( error ) {
+        std::cerr << "Could not create " << shardDir << ": " << error.message() << "\n";
+        return {};
+    }
+    std::vector<std::vector<std::string>> parts = partition( shards );
+
+    std::vector<std::string> resultFiles;
+    std::vector<std::thread> runners;
+    for ( size_t i = 0; i < parts.size(); i++ ) {
+        std::string stem = shardDir + "/shard-" + std::to_string( i );
+        // Result files are append-only, start every run from empty ones
+        std::filesystem::remove( stem + ".sifr", error );
+        std::filesystem::remove( stem + ".log", error );
+        // More shards than files leaves some empty, they get no process and no result file
+        if ( parts[ i ].empty() ) {
+            continue;
+        }
+        resultFiles.push_back( stem + ".sifr" );
+        runners.emplace_back( [this, &parts, i, stem]() { runShard( parts[ i ], stem + ".sifr", stem + ".log" ); } );
+    }
+    for ( std::thread &runner : runners ) {
+        runner.join();
+    }
+    return resultFiles;
+}
+
+ShardRunner::MergeStats ShardRunner::merge( const std::vector<std::string> &resultFiles, std::ostream &out ) {
+
+    MergeStats stats;
+
+    // The views point into the mappings, which stay open until the report is written
+    std::vector<ResultReader> readers;
+    std::vector<ResultFile::FeatureView> features;
+    std::vector<ResultFile::FileView> failed;
+    std::set<std::string_view> files;
+
+    for ( const std::string &path : resultFiles ) {
+        ResultReader reader;
+        if ( !reader.open( path ) ) {
+            std::cerr << path << ": not a result file\n";
+            continue;
+        }
+        bool complete = reader.forEach(
+            [&]( const ResultFile::FileView &file ) {
+                stats.records++;
+                files.insert( file.path );
+                if ( file.flags & ( ResultFile::ParseFailed | ResultFile::Crashed | ResultFile::TimedOut ) ) {
+                    failed.push_back( file );
+                } else if ( file.flags & ResultFile::Truncated ) {
+                    stats.truncatedFiles++;
+                    std::cerr << file.path << ": truncated, budget ran out\n";
+                }
+            },
+            [&]( const ResultFile::FeatureView &feature ) {
+                stats.records++;
+                features.push_back( feature );
+            } );
+        if ( !complete ) {
+            stats.tornShards++;
+        }
+        readers.push_back( std::move( reader ) );
+    }
+
+    auto key = []( const ResultFile::FeatureView &feature ) {
+        return std::tie( feature.file, feature.line, feature.name );
+    };
+    std::sort( features.begin(), features.end(),
+               [&]( const ResultFile::FeatureView &a, const ResultFile::FeatureView &b ) { return key( a ) < key( b ); } );
+    features.erase( std::unique( features.begin(), features.end(),
+                                 [&]( const ResultFile::FeatureView &a, const ResultFile::FeatureView &b ) {
+                                     return key( a ) == key( b );
+                                 } ),
+                    features.end() );
+
+    // Same wording as SeminalInputFeatureDetector::printSeminalInputFeatures, prefixed with the file
+    for ( const ResultFile::FeatureView &feature : features ) {
+        out << feature.file << ": Line " << feature.line << ": " << ( feature.type == "FILE *" ? "size of file " : "" )
+            << feature.name << "\n";
+    }
+
+    std::sort( failed.begin(), failed.end(),
+               []( const ResultFile::FileView &a, const ResultFile::FileView &b ) { return a.path < b.path; } );
+    for ( const ResultFile::FileView &file : failed ) {
+        const char *reason = file.flags & ResultFile::Crashed    ? "analyzer crashed"
+                             : file.flags & ResultFile::TimedOut ? "analyzer timed out"
+                                                                 : "parse failed";
+        std::cerr << file.path << ": " << reason << "\n";
+    }
+
+    stats.features = features.size();
+    stats.files = files.size();
+    stats.failedFiles = failed.size();
+    return stats;
+}
@@ -0,0 +1,83 @@
+/**
+ * ShardRunner.h
+*/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Splits a file set into shards, analyzes every shard in its own detector
+// process and merges the result files of the shards into one report.
+//
+// Each process is a normal run with --result-file, so a libclang crash only
+// costs the file it happened on: the runner sees which files of the shard
+// made it into the result file, records the next one as crashed and starts a
+// new process for the rest.
+class ShardRunner {
+
+public:
+
+    // Totals of a merge
+    struct MergeStats {
+        size_t records = 0;
+        size_t features = 0;
+        size_t files = 0;
+        size_t failedFiles = 0;
+        size_t truncatedFiles = 0;
+        // Result files that ended in a torn group
+        size_t tornShards = 0;
+    };
+
+    // program is the detector binary, engineArgs are added in front of the files
+    ShardRunner( const std::string &program, const std::vector<std::string> &engineArgs,
+                 const std::string &shardDir );
+
+    // Kills a process that has not finished a file for this many seconds and
+    // records the file as timed out, 0 waits forever. This is the hard bound
+    // behind the detector's cooperative budgets, which cannot stop a parse.
+    void setStallTimeout( double seconds ) { stallTimeout = seconds; }
+
+    void addFile( const std::string &file );
+
+    // Adds the paths of a manifest, one per line, blank lines and # comments
+    // are skipped. False if it cannot be read.
+    static bool readManifest( const std::string &manifest, std::vector<std::string> &paths );
+
+    // Analyzes the files in shards processes at once, returns the result files
+    // of the shards that got files
+    std::vector<std::string> run( unsigned shards );
+
+    // Merges result files into one report sorted by file, line and name. A
+    // feature found more than once (the same file in several shards) is
+    // reported once.
+    static MergeStats merge( const std::vector<std::string> &resultFiles, std::ostream &out );
+
+private:
+
+    std::string program;
+    std::vector<std::string> engineArgs;
+    std::string shardDir;
+    std::vector<std::string> files;
+    double stallTimeout = 0;
+
+    // How a detector process ended
+    enum ProcessEnd {
+        Finished,
+        Crashed,
+        Stalled
+    };
+
+    // Splits the files into shards of about equal total size, largest files first
+    std::vector<std::vector<std::string>> partition( unsigned shards ) const;
+
+    // Runs one shard to completion, restarting after crashes. A torn group at
+    // the end of the result file is cut off before the restart.
+    void runShard( const std::vector<std::string> &shardFiles, const std::string &resultFile,
+                   const std::string &logFile ) const;
+
+    // Spawns one detector process and waits for it
+    ProcessEnd spawn( const std::vector<std::string> &shardFiles, const std::string &resultFile,
+                      const std::string &logFile ) const;
+};
@@ -0,0 +1,110 @@
+/**
+ * SmallVector.h
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Vector that keeps its first N elements inside the object and only allocates
+// once it grows past them. Conditions rarely read more than a handful of
+// variables, so collecting them this way normally never touches the heap.
+template <typename T, size_t N>
+class SmallVector {
+
+public:
+
+    SmallVector() = default;
+
+    SmallVector( const SmallVector &other ) {
+        for ( const T &value : other ) {
+            push_back( value );
+        }
+    }
+
+    SmallVector( SmallVector &&other ) {
+        if ( other.isInline() ) {
+            for ( T &value : other ) {
+                push_back( std::move( value ) );
+            }
+            other.clear();
+        } else {
+            // Take over the heap buffer
+            elements = other.elements;
+            count = other.count;
+            capacity = other.capacity;
+            other.elements = other.inlineElements();
+            other.count = 0;
+            other.capacity = N;
+        }
+    }
+
+    SmallVector &operator=( SmallVector other ) {
+        clear();
+        for ( T &value : other ) {
+            push_back( std::move( value ) );
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        clear();
+        if ( !isInline() ) {
+            ::operator delete( elements );
+        }
+    }
+
+    void push_back( T value ) {
+        if ( count == capacity ) {
+            grow();
+        }
+        new ( elements + count ) T( std::move( value ) );
+        count++;
+    }
+
+    void clear() {
+        for ( size_t i = 0; i < count; i++ ) {
+            elements[ i ].~T();
+        }
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    // True while the elements still live inside the object
+    bool isInline() const { return elements == inlineElements(); }
+
+    T &operator[]( size_t i ) { return elements[ i ]; }
+    const T &operator[]( size_t i ) const { return elements[ i ]; }
+
+    T *begin() { return elements; }
+    T *end() { return elements + count; }
+    const T *begin() const { return elements; }
+    const T *end() const { return elements + count; }
+
+private:
+
+    alignas( T ) unsigned char storage[ N * sizeof( T ) ];
+    T *elements = inlineElements();
+    size_t count = 0;
+    size_t capacity = N;
+
+    T *inlineElements() { return reinterpret_cast<T *>( storage ); }
+    const T *inlineElements() const { return reinterpret_cast<const T *>( storage ); }
+
+    void grow() {
+        size_t newCapacity = capacity * 2;
+        T *moved = static_cast<T *>( ::operator new( newCapacity * sizeof( T ) ) );
+        for ( size_t i = 0; i < count; i++ ) {
+            new ( moved + i ) T( std::move( elements[ i ] ) );
+            elements[ i ].~T();
+        }
+        if ( !isInline() ) {
+            ::operator delete( elements );
+        }
+        elements = moved;
+        capacity = newCapacity;
+    }
+};
@@ -1,36 +1,421 @@
-/** 
- * main.cpp
- * @author Carter Fultz (cmfultz)
-*/
-
-#include "SeminalInputFeatureDetector.h"
-#include "KeyPointsCollector.h"
-#include <iostream>
-#include <fstream>
-
-int main( int argc, char *argv[] )
-{
-    // Get filename
-    std::string filename;
-    std::cout << "Enter a file name for analysis: ";
-    std::cin >> filename;
-
-    // Debugger on or off
-    bool debug;
-    std::string debugStr;
-    std::cout << "Would you like the debugger on? (y/n): ";
-    std::cin >> debugStr;
-
-    if ( debugStr == "y" ) {
-        debug = true;
-    } else if ( debugStr == "n" ) {
-        debug = false;
-    }
-
-    // Call SeminalInputFeatureDetector constructor
-    SeminalInputFeatureDetector detector( filename, debug );
-    detector.cursorFinder();
-
-    return EXIT_SUCCESS;
-
-}
+/**
+ * main.cpp
+ * @author Carter Fultz (cmfultz)
+*/
+
+#include "SeminalInputFeatureDetector.h"
+#include "KeyPointsCollector.h"
+#include "DifferentialHarness.h"
+#include "CompilationDatabase.h"
+#include "ResultFile.h"
+#include "ShardRunner.h"
+#include "DynamicValidator.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+
+static void printUsage( const char *program ) {
+    std::cout << "Usage: " << program << " [options] <file>...\n"
+              << "       " << program << " --compare[=ARGS] [compare options] <file|dir>...\n"
+              << "       " << program << " --shards=N [options] <file>...\n"
+              << "       " << program << " --merge <result file>...\n"
+              << "       " << program << "                 (interactive)\n"
+              << "Options:\n"
+              << "  -d, --debug              print the traversal\n"
+              << "  --seed-hints[=DIR]       write DIR/<file>.dict and DIR/<file>.seeds for fuzzers (default DIR: out)\n"
+              << "  --single-parse           reuse the KeyPointsCollector parse instead of parsing twice\n"
+              << "  -p DIR, --compile-commands=DIR\n"
+              << "                           parse with the flags from DIR/compile_commands.json;\n"
+              << "                           without files, analyze every file in it\n"
+              << "  --all-conditions         report every variable of a branch condition, not only the first\n"
+              << "  --rank                   print the features most influential first (loop depth, loop bounds,\n"
+              << "                           branch count and code size of the branches they control)\n"
+              << "  --time-budget=SECONDS    stop analyzing a file after SECONDS, its results are marked truncated\n"
+              << "  --memory-budget=MB       stop analyzing a file once it grew the process by MB megabytes\n"
+              << "  --manifest=FILE          analyze the files listed in FILE, one per line\n"
+              << "  --result-file=FILE       also append the results to the binary result file FILE\n"
+              << "  --validate=DIR           compile the file with probes on its branches ($CC, default clang), run it\n"
+              << "                           on every file in DIR and report which features change the branch outcomes\n"
+              << "  --validate-args=ARGS     arguments of those runs, @@ is the input file (default: input on stdin)\n"
+              << "Sharding (split the files between N analyzer processes and merge their result files):\n"
+              << "  --shards=N               number of processes\n"
+              << "  --shard-dir=DIR          where the result files and logs go (default out/shards)\n"
+              << "  --merge                  only merge the given result files into one sorted report\n"
+              << "Compare options (diff the reference engine against one run with ARGS, default --single-parse):\n"
+              << "  --reference=ARGS         options of the reference runs (default none)\n"
+              << "  --corpus=N               also generate N programs into out/corpus\n"
+              << "  -j N, --jobs=N           analyzer processes to run at once (default: cores)\n";
+}
+
+// Splits a space separated option list
+static std::vector<std::string> splitArgs( const std::string &args ) {
+    std::vector<std::string> result;
+    std::istringstream stream( args );
+    std::string arg;
+    while ( stream >> arg ) {
+        result.push_back( arg );
+    }
+    return result;
+}
+
+// Reads a whole decimal number of at least minimum, false for anything else
+// (signs, trailing text, out of range), so bad options end in the usage
+template <typename Number>
+static bool parseNumber( const std::string &text, Number &value, Number minimum = 0 ) {
+    if ( text.empty() || !std::isdigit( static_cast<unsigned char>( text[0] ) ) ) {
+        return false;
+    }
+    char *end;
+    errno = 0;
+    unsigned long long number = std::strtoull( text.c_str(), &end, 10 );
+    if ( *end != '\0' || errno == ERANGE || number < minimum || number > std::numeric_limits<Number>::max() ) {
+        return false;
+    }
+    value = static_cast<Number>( number );
+    return true;
+}
+
+// Reads a non-negative number of seconds
+static bool parseSeconds( const std::string &text, double &value ) {
+    if ( text.empty() || !( std::isdigit( static_cast<unsigned char>( text[0] ) ) || text[0] == '.' ) ) {
+        return false;
+    }
+    char *end;
+    double seconds = std::strtod( text.c_str(), &end );
+    if ( *end != '\0' || !std::isfinite( seconds ) ) {
+        return false;
+    }
+    value = seconds;
+    return true;
+}
+
+// Path of this binary, so the harness can spawn more of it
+static std::string selfPath( const char *argv0 ) {
+    char buffer[4096];
+    ssize_t n = readlink( "/proc/self/exe", buffer, sizeof( buffer ) - 1 );
+    if ( n > 0 ) {
+        return std::string( buffer, n );
+    }
+    return argv0;
+}
+
+int main( int argc, char *argv[] )
+{
+    std::string filename;
+    bool debug = false;
+    std::string seedHintDir;
+    std::string compileCommandsDir;
+    DetectorOptions options;
+
+    // Differential mode
+    bool compare = false;
+    std::string referenceArgs;
+    std::string candidateArgs = "--single-parse";
+    unsigned corpus = 0;
+    unsigned jobs = std::thread::hardware_concurrency();
+    std::vector<std::string> paths;
+    CompilationDatabase database;
+
+    // Sharded mode
+    unsigned shards = 0;
+    std::string shardDir = "out/shards";
+    std::string resultFile;
+    bool merge = false;
+    // Options the shard processes are started with
+    std::vector<std::string> engineArgs;
+
+    // Dynamic validation, sample inputs and the arguments to run them with
+    std::vector<std::string> sampleInputs;
+    std::vector<std::string> validateArgs;
+    bool validate = false;
+
+    if ( argc > 1 ) {
+        for ( int i = 1; i < argc; i++ ) {
+            std::string arg = argv[ i ];
+            if ( arg == "-d" || arg == "--debug" ) {
+                debug = true;
+            } else if ( arg == "--seed-hints" ) {
+                seedHintDir = "out";
+                engineArgs.push_back( arg );
+            } else if ( arg.rfind( "--seed-hints=", 0 ) == 0 ) {
+                seedHintDir = arg.substr( std::strlen( "--seed-hints=" ) );
+                engineArgs.push_back( arg );
+            } else if ( arg == "-p" && i + 1 < argc ) {
+                compileCommandsDir = argv[ ++i ];
+                engineArgs.push_back( "--compile-commands=" + compileCommandsDir );
+            } else if ( arg.rfind( "--compile-commands=", 0 ) == 0 ) {
+                compileCommandsDir = arg.substr( std::strlen( "--compile-commands=" ) );
+                engineArgs.push_back( arg );
+            } else if ( arg == "--single-parse" ) {
+                options.singleParse = true;
+                engineArgs.push_back( arg );
+            } else if ( arg == "--all-conditions" ) {
+                options.completeConditions = true;
+                engineArgs.push_back( arg );
+            } else if ( arg == "--rank" ) {
+                options.rankByInfluence = true;
+                engineArgs.push_back( arg );
+            } else if ( arg.rfind( "--time-budget=", 0 ) == 0 ) {
+                if ( !parseSeconds( arg.substr( std::strlen( "--time-budget=" ) ), options.timeBudget ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+                engineArgs.push_back( arg );
+            } else if ( arg.rfind( "--memory-budget=", 0 ) == 0 ) {
+                // Budget counts bytes, more megabytes than that would wrap
+                if ( !parseNumber( arg.substr( std::strlen( "--memory-budget=" ) ), options.memoryBudget )
+                     || options.memoryBudget > std::numeric_limits<size_t>::max() / ( 1024 * 1024 ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+                engineArgs.push_back( arg );
+            } else if ( arg.rfind( "--manifest=", 0 ) == 0 ) {
+                if ( !ShardRunner::readManifest( arg.substr( std::strlen( "--manifest=" ) ), paths ) ) {
+                    std::cerr << "Could not read " << arg.substr( std::strlen( "--manifest=" ) ) << "\n";
+                    return EXIT_FAILURE;
+                }
+            } else if ( arg.rfind( "--validate=", 0 ) == 0 ) {
+                std::string inputDir = arg.substr( std::strlen( "--validate=" ) );
+                std::error_code error;
+                for ( const auto &entry : std::filesystem::directory_iterator( inputDir, error ) ) {
+                    if ( entry.is_regular_file() ) {
+                        sampleInputs.push_back( entry.path().string() );
+                    }
+                }
+                if ( error || sampleInputs.empty() ) {
+                    std::cerr << "No sample inputs in " << inputDir << "\n";
+                    return EXIT_FAILURE;
+                }
+                std::sort( sampleInputs.begin(), sampleInputs.end() );
+                validate = true;
+            } else if ( arg.rfind( "--validate-args=", 0 ) == 0 ) {
+                validateArgs = splitArgs( arg.substr( std::strlen( "--validate-args=" ) ) );
+            } else if ( arg.rfind( "--result-file=", 0 ) == 0 ) {
+                resultFile = arg.substr( std::strlen( "--result-file=" ) );
+            } else if ( arg.rfind( "--shards=", 0 ) == 0 ) {
+                if ( !parseNumber( arg.substr( std::strlen( "--shards=" ) ), shards, 1u ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+            } else if ( arg.rfind( "--shard-dir=", 0 ) == 0 ) {
+                shardDir = arg.substr( std::strlen( "--shard-dir=" ) );
+            } else if ( arg == "--merge" ) {
+                merge = true;
+            } else if ( arg == "--compare" ) {
+                compare = true;
+            } else if ( arg.rfind( "--compare=", 0 ) == 0 ) {
+                compare = true;
+                candidateArgs = arg.substr( std::strlen( "--compare=" ) );
+            } else if ( arg.rfind( "--reference=", 0 ) == 0 ) {
+                referenceArgs = arg.substr( std::strlen( "--reference=" ) );
+            } else if ( arg.rfind( "--corpus=", 0 ) == 0 ) {
+                if ( !parseNumber( arg.substr( std::strlen( "--corpus=" ) ), corpus ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+            } else if ( arg == "-j" && i + 1 < argc ) {
+                if ( !parseNumber( std::string( argv[ ++i ] ), jobs, 1u ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+            } else if ( arg.rfind( "--jobs=", 0 ) == 0 ) {
+                if ( !parseNumber( arg.substr( std::strlen( "--jobs=" ) ), jobs, 1u ) ) {
+                    printUsage( argv[0] );
+                    return EXIT_FAILURE;
+                }
+            } else if ( arg == "-h" || arg == "--help" ) {
+                printUsage( argv[0] );
+                return EXIT_SUCCESS;
+            } else if ( arg[0] != '-' ) {
+                paths.push_back( arg );
+            } else {
+                printUsage( argv[0] );
+                return EXIT_FAILURE;
+            }
+        }
+
+        if ( !compileCommandsDir.empty() ) {
+            if ( !database.load( compileCommandsDir ) ) {
+                std::cerr << "Could not load " << compileCommandsDir << "/compile_commands.json\n";
+                return EXIT_FAILURE;
+            }
+            if ( paths.empty() ) {
+                paths = database.files();
+            }
+        }
+
+        if ( merge || shards ) {
+            std::vector<std::string> resultFiles = paths;
+            if ( !merge ) {
+                ShardRunner runner( selfPath( argv[0] ), engineArgs, shardDir );
+                if ( options.timeBudget > 0 ) {
+                    // Parses cannot be cancelled from inside, give them twice the budget before killing
+                    runner.setStallTimeout( 2 * options.timeBudget + 5 );
+                }
+                for ( const std::string &path : paths ) {
+                    runner.addFile( path );
+                }
+                resultFiles = runner.run( shards );
+            }
+            ShardRunner::MergeStats stats = ShardRunner::merge( resultFiles, std::cout );
+            std::cerr << "merged " << stats.records << " records from " << resultFiles.size() << " result files: "
+                      << stats.features << " features in " << stats.files << " files, " << stats.failedFiles
+                      << " failed, " << stats.truncatedFiles << " truncated";
+            if ( stats.tornShards ) {
+                std::cerr << ", " << stats.tornShards << " result files end in a torn record";
+            }
+            std::cerr << "\n";
+            return stats.failedFiles ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+
+        if ( compare ) {
+            std::vector<std::string> reference = splitArgs( referenceArgs );
+            std::vector<std::string> candidate = splitArgs( candidateArgs );
+            if ( !compileCommandsDir.empty() ) {
+                for ( std::vector<std::string> *engine : { &reference, &candidate } ) {
+                    engine->push_back( "--compile-commands=" + compileCommandsDir );
+                }
+            }
+            DifferentialHarness harness( selfPath( argv[0] ), reference, candidate );
+            for ( const std::string &path : paths ) {
+                harness.addPath( path );
+            }
+            if ( corpus ) {
+                harness.generateCorpus( "out/corpus", corpus );
+            }
+            return harness.run( jobs ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        if ( paths.empty() ) {
+            printUsage( argv[0] );
+            return EXIT_FAILURE;
+        }
+        filename = paths[0];
+    } else {
+        // Get filename
+        std::cout << "Enter a file name for analysis: ";
+        std::cin >> filename;
+
+        // Debugger on or off
+        std::string debugStr;
+        std::cout << "Would you like the debugger on? (y/n): ";
+        std::cin >> debugStr;
+
+        if ( debugStr == "y" ) {
+            debug = true;
+        } else if ( debugStr == "n" ) {
+            debug = false;
+        }
+    }
+
+    // Surfaces parse problems, they usually mean missing or wrong compile flags
+    bool uncountedNoted = false;
+    auto reportParse = [&]( const SeminalInputFeatureDetector &detector, const std::string &file, unsigned flagSet ) {
+        const SeminalInputFeatureDetector::ParseReport &report = detector.getParseReport();
+        if ( !report.counted ) {
+            if ( !uncountedNoted && options.singleParse ) {
+                std::cerr << "--single-parse does not parse the files themselves, their errors and warnings are not counted\n";
+                uncountedNoted = true;
+            }
+        } else if ( report.failed ) {
+            std::cerr << file << ": parse failed (flag set " << flagSet << ")\n";
+        } else if ( report.errors || report.warnings ) {
+            std::cerr << file << ": " << report.errors << " errors, " << report.warnings
+                      << " warnings (flag set " << flagSet << ")\n";
+        }
+    };
+
+    // Binary results for sharded runs, appended after every file
+    ResultWriter results;
+    if ( !resultFile.empty() && !results.open( resultFile ) ) {
+        std::cerr << "Could not open " << resultFile << "\n";
+        return EXIT_FAILURE;
+    }
+    // False if the results could not be written, the run stops so a shard
+    // runner sees the file as failed
+    auto recordResults = [&]( const SeminalInputFeatureDetector &detector, const std::string &file ) {
+        if ( detector.isTruncated() ) {
+            const Budget &budget = detector.getBudget();
+            std::cerr << file << ": truncated, " << ( budget.reason() == Budget::Time ? "time" : "memory" )
+                      << " budget ran out, " << budget.elapsed() << "s spent\n";
+        }
+        if ( resultFile.empty() ) {
+            return true;
+        }
+        const SeminalInputFeatureDetector::ParseReport &report = detector.getParseReport();
+        uint16_t flags = ( report.failed ? ResultFile::ParseFailed : 0 ) | ( report.errors ? ResultFile::HasErrors : 0 )
+                         | ( report.counted ? 0 : ResultFile::Uncounted )
+                         | ( detector.isTruncated() ? ResultFile::Truncated : 0 );
+        if ( !results.append( file, flags, detector.getSeminalInputFeatures() ) ) {
+            std::cerr << "Could not write " << file << " to " << resultFile << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    // Runs the probed program on the sample inputs, after the static report
+    auto validateResults = [&]( const SeminalInputFeatureDetector &detector, const std::string &file,
+                                const std::vector<std::string> &args ) {
+        if ( !validate ) {
+            return;
+        }
+        DynamicValidator validator( file, args );
+        if ( !validator.build( detector.getProbePlan() ) ) {
+            std::cerr << file << ": probed program does not compile, see " << validator.getLog() << "\n";
+            return;
+        }
+        validator.run( sampleInputs, validateArgs, options.timeBudget > 0 ? options.timeBudget : 10.0 );
+        std::vector<std::string> features;
+        for ( const SeminalInputFeatureDetector::SeminalInputFeature &feature : detector.getSeminalInputFeatures() ) {
+            features.push_back( feature.name );
+        }
+        std::cout << "\n";
+        validator.report( features, std::cout );
+    };
+
+    // Call SeminalInputFeatureDetector constructor
+    std::shared_ptr<const CompilationDatabase::FlagSet> flags = database.flagsFor( filename );
+    SeminalInputFeatureDetector detector( filename, debug, options, flags->args );
+    if ( !seedHintDir.empty() ) {
+        detector.setSeedHintOutput( seedHintDir );
+    }
+    if ( validate ) {
+        detector.enableProbes();
+    }
+    reportParse( detector, filename, flags->id );
+    detector.cursorFinder();
+    if ( !recordResults( detector, filename ) ) {
+        return EXIT_FAILURE;
+    }
+    validateResults( detector, filename, flags->args );
+
+    // Further files reuse the same detector
+    for ( size_t i = 1; i < paths.size(); i++ ) {
+        std::cout << "\n" << paths[ i ] << ":\n";
+        flags = database.flagsFor( paths[ i ] );
+        detector.reset( paths[ i ], flags->args );
+        reportParse( detector, paths[ i ], flags->id );
+        detector.cursorFinder();
+        if ( !recordResults( detector, paths[ i ] ) ) {
+            return EXIT_FAILURE;
+        }
+        validateResults( detector, paths[ i ], flags->args );
+    }
+
+    if ( !compileCommandsDir.empty() && debug ) {
+        std::cout << "\n" << paths.size() << " files, " << database.flagSetCount() << " distinct flag sets\n";
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,40 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/* Five include directives in front of the code: the KeyPointsCollector
+   parses this file with them removed, so every line it reports is five
+   lower than the line here. */
+
+int count_words(FILE *fp) {
+  int words = 0;
+  bool inside = false;
+  int ch;
+  while ((ch = fgetc(fp)) != EOF) {
+    if (isspace(ch)) {
+      inside = false;
+    } else if (!inside) {
+      inside = true;
+      words++;
+    }
+  }
+  return words;
+}
+
+int main(void) {
+  int limit;
+  char name[64];
+  scanf("%d %63s", &limit, name);
+  FILE *fp = fopen(name, "r");
+  if (fp == NULL) {
+    return 1;
+  }
+  int words = count_words(fp);
+  for (int i = 0; i < limit; i++) {
+    printf("%d\n", words);
+  }
+  fclose(fp);
+  return strlen(name) > 0 ? 0 : 1;
+}